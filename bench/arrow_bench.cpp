@@ -0,0 +1,171 @@
+// Repaint and hit-test cost of scene arrows, the previous CArrow geometry
+// against the cached one.
+//
+//    arrow_bench [arrows] [nodes]
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPainter>
+#include <QVector2D>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "carrow.h"
+#include "cnode.h"
+#include "common.h"
+
+static const double  pi             = 3.14159265358979323846;
+
+static const int     hit_tests      = 10000;
+static const int     repaints       = 50;
+static const int     repaint_size   = 1000;
+
+//----------------------------------------------------------------------
+// Arrow as it was before the geometry was cached: loose bounds, default
+// shape, head transform computed on every paint
+class LegacyArrow : public QGraphicsItem
+{
+public:
+   LegacyArrow(CNode* pSource_, CNode* pTarget_, const QString& name_)
+   {
+      setData(eID, QVariant(name_));
+
+      m_pen = QPen(QColor(Qt::darkGray), Qt::SolidLine);
+
+      m_head.moveTo(0, 0);
+      m_head.lineTo(-arrow_head_size, -arrow_head_size * 0.125);
+      m_head.lineTo(-arrow_head_size,  arrow_head_size * 0.125);
+      m_head.lineTo(0, 0);
+      m_head.closeSubpath();
+
+      auto source_pos = pSource_->sceneBoundingRect().center();
+      m_x1 = source_pos.x();
+      m_y1 = source_pos.y();
+
+      auto target_pos = pTarget_->sceneBoundingRect().center();
+      m_x2 = target_pos.x();
+      m_y2 = target_pos.y();
+   }
+
+   QRectF boundingRect() const override
+   {
+      return QRectF(
+               std::min(m_x1, m_x2) - arrow_head_size, std::min(m_y1, m_y2) - arrow_head_size,
+               std::max(m_x1, m_x2) + arrow_head_size, std::max(m_y1, m_y2) + arrow_head_size);
+   }
+
+   void paint(QPainter* pPainter_, const QStyleOptionGraphicsItem*, QWidget*) override
+   {
+      pPainter_->setPen(m_pen);
+      pPainter_->drawLine(m_x1, m_y1, m_x2, m_y2);
+
+      QVector2D dir = QVector2D(m_x2 - m_x1, m_y2 - m_y1).normalized();
+
+      qreal tetha = std::atan2(dir.y(), dir.x()) * 180.0 / pi;
+
+      pPainter_->translate(m_x2, m_y2);
+      pPainter_->translate(-dir.x() * blob_radius, -dir.y() * blob_radius);
+      pPainter_->rotate(tetha);
+
+      pPainter_->fillPath(m_head, Qt::darkGray);
+      pPainter_->drawPath(m_head);
+   }
+
+private:
+   qreal m_x1 {}, m_y1 {}, m_x2 {}, m_y2 {};
+   QPen  m_pen;
+   QPainterPath m_head;
+};
+
+//----------------------------------------------------------------------
+template <typename TArrow>
+static void run(const char* name_, int arrows_, int nodes_)
+{
+   std::mt19937 rng(7);
+   std::uniform_real_distribution<double> coord(0.0, scene_size);
+   std::uniform_int_distribution<int>     node(0, nodes_ - 1);
+
+   QGraphicsScene scene(0, 0, scene_size, scene_size);
+
+   std::vector<CNode*> nodes;
+   nodes.reserve(nodes_);
+
+   for (int i = 0; i < nodes_; ++i)
+   {
+      nodes.push_back(new CNode(coord(rng), coord(rng), QString::number(i)));
+      scene.addItem(nodes.back());
+   }
+
+   // Arrows mostly connect nearby nodes, as laid out graphs do
+   std::sort(nodes.begin(), nodes.end(), [](CNode* pLeft_, CNode* pRight_)
+   {
+      return pLeft_->pos().x() < pRight_->pos().x();
+   });
+
+   std::uniform_int_distribution<int> near(-nodes_ / 100 - 1, nodes_ / 100 + 1);
+
+   for (int i = 0; i < arrows_; ++i)
+   {
+      int source = node(rng);
+      int target = std::clamp(source + near(rng), 0, nodes_ - 1);
+
+      scene.addItem(new TArrow(nodes[source], nodes[target], QString::number(i)));
+   }
+
+   QElapsedTimer clock;
+
+   clock.start();
+   scene.items(QRectF(0, 0, 1, 1));
+   qint64 index_ms = clock.elapsed();
+
+   clock.start();
+
+   size_t hits {};
+   for (int i = 0; i < hit_tests; ++i)
+      hits += scene.items(QPointF(coord(rng), coord(rng))).size();
+
+   qint64 hit_ms = clock.elapsed();
+
+   QImage image(repaint_size, repaint_size, QImage::Format_ARGB32_Premultiplied);
+   std::uniform_real_distribution<double> corner(0.0, scene_size - repaint_size);
+
+   clock.start();
+
+   for (int i = 0; i < repaints; ++i)
+   {
+      image.fill(Qt::white);
+
+      QPainter painter(&image);
+      QRectF   source(corner(rng), corner(rng), repaint_size, repaint_size);
+
+      scene.render(&painter, QRectF(image.rect()), source);
+   }
+
+   qint64 paint_ms = clock.elapsed();
+
+   printf("%-8s arrows %d  nodes %d  index %lld ms  hit-test %lld ms (%zu hits)  repaint %lld ms\n",
+      name_, arrows_, nodes_, index_ms, hit_ms, hits, paint_ms);
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+
+   QApplication app(argc, argv);
+
+   int arrows  = argc > 1 ? atoi(argv[1]) : 100000;
+   int nodes   = argc > 2 ? atoi(argv[2]) : 20000;
+
+   run<LegacyArrow>("before", arrows, nodes);
+   run<CArrow>     ("after",  arrows, nodes);
+
+   return 0;
+}
@@ -0,0 +1,110 @@
+#include "generator.h"
+#include "common.h"
+#include "model.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+
+using namespace cat;
+
+//----------------------------------------------------------------------
+void generator::Generate(const Spec& spec_, dat::Document& doc_)
+{
+   std::mt19937 rng(spec_.seed);
+
+   std::uniform_int_distribution<int>     coord    (0, scene_size);
+   std::uniform_int_distribution<int>     integer  (0, 99);
+   std::uniform_real_distribution<double> real     (0.0, 100.0);
+
+   const std::string_view set = doc_.Own(model::sSet);
+
+   doc_.nodes.reserve(spec_.nodes + 1);
+
+   for (size_t i = 0; i < spec_.nodes; ++i)
+      doc_.nodes.push_back(doc_.Own("n" + std::to_string(i)));
+
+   doc_.nodes.push_back(set);
+
+   for (size_t i = 0; i < spec_.nodes; ++i)
+   {
+      dat::Arrow arrow;
+      arrow.name     = doc_.Own("s" + std::to_string(i));
+      arrow.source   = doc_.nodes[i];
+      arrow.target   = set;
+
+      arrow.first_property = (uint32_t)doc_.properties.size();
+
+      doc_.properties.push_back(dat::FromValue(Function(model::x_token, TSetValue(coord(rng))), doc_));
+      doc_.properties.push_back(dat::FromValue(Function(model::y_token, TSetValue(coord(rng))), doc_));
+
+      for (size_t j = 0; j < spec_.properties; ++j)
+      {
+         TSetValue value;
+
+         switch (spec_.types.empty() ? 'i' : spec_.types[j % spec_.types.size()])
+         {
+         case 'd':   value = real(rng);                                  break;
+         case 'f':   value = float(real(rng));                           break;
+         case 's':   value = "s" + std::to_string(integer(rng));         break;
+         default:    value = integer(rng);                               break;
+         }
+
+         doc_.properties.push_back(dat::FromValue(Function("p" + std::to_string(j), value), doc_));
+      }
+
+      arrow.property_count = (uint32_t)doc_.properties.size() - arrow.first_property;
+
+      doc_.arrows.push_back(arrow);
+   }
+
+   if (spec_.nodes == 0)
+      return;
+
+   const size_t arrows = size_t(spec_.nodes * spec_.density);
+   const int    spread = int(spec_.nodes / 100) + 1;
+
+   std::uniform_int_distribution<size_t>  node(0, spec_.nodes - 1);
+   std::uniform_int_distribution<int>     near(-spread, spread);
+
+   doc_.arrows.reserve(doc_.arrows.size() + arrows);
+
+   for (size_t i = 0; i < arrows; ++i)
+   {
+      size_t source = node(rng);
+      size_t target = (size_t)std::clamp<int64_t>(int64_t(source) + near(rng), 0, int64_t(spec_.nodes) - 1);
+
+      // Identities are implied, they are never stored
+      if (target == source)
+         target = (source + 1) % spec_.nodes;
+
+      dat::Arrow arrow;
+      arrow.name     = doc_.Own("a" + std::to_string(i));
+      arrow.source   = doc_.nodes[source];
+      arrow.target   = doc_.nodes[target];
+
+      arrow.first_property = (uint32_t)doc_.properties.size();
+
+      doc_.arrows.push_back(arrow);
+   }
+}
+
+//----------------------------------------------------------------------
+bool generator::Write(const Spec& spec_, const std::string& path_)
+{
+   dat::Document doc;
+   Generate(spec_, doc);
+
+   std::string buffer;
+   if (!dat::Write(doc, buffer))
+      return false;
+
+   std::ofstream output(path_, std::ios::out | std::ios::binary);
+   if (!output.is_open())
+      return false;
+
+   output.write(buffer.data(), buffer.size());
+   output.close();
+
+   return !output.fail();
+}
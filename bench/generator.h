@@ -0,0 +1,34 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+#include "datfile.h"
+
+// Synthetic categories for the benchmarks
+namespace generator
+{
+   struct Spec
+   {
+      size_t         nodes       { 1000 };
+
+      // Arrows between nodes, per node
+      double         density     { 2.0 };
+
+      // Properties p0, p1... per node, typed by cycling through types:
+      // i int, d double, f float, s string
+      size_t         properties  { 4 };
+      std::string    types       { "ids" };
+
+      uint32_t       seed        { 7 };
+   };
+
+   // Nodes n0, n1... and the set node. Every node carries its position and
+   // properties on its arrow to the set, arrows mostly join nearby nodes
+   void Generate(const Spec& spec_, dat::Document& doc_);
+
+   bool Write(const Spec& spec_, const std::string& path_);
+}
+
+#endif
@@ -0,0 +1,291 @@
+// Scaling of the scene operations on synthetic categories.
+//
+//    scene_bench [--sizes 1000,10000,100000,1000000] [--density 2]
+//                [--properties 4] [--types ids] [--filter "p0 < 50"]
+//                [--text file]
+//
+// Prints one JSON object per operation and size: time, throughput and the
+// peak resident memory during the operation. Every size runs in a process
+// of its own so that peaks do not carry over. The generator only writes
+// .dat, Build is measured on the Cat text file given with --text.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsSceneMouseEvent>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+
+#include <cstdio>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "cnode.h"
+#include "generator.h"
+#include "scene.h"
+
+#ifndef CATEDITOR_VERSION
+#define CATEDITOR_VERSION "unknown"
+#endif
+
+static const int     drag_steps     = 20;
+static const int     drag_max_nodes = 1000;
+
+struct Context
+{
+   qint64   size     {};
+   qint64   nodes    {};
+   qint64   arrows   {};
+};
+
+//----------------------------------------------------------------------
+// Restarts the peak measurement where the kernel allows it
+static void resetPeak()
+{
+   QFile refs("/proc/self/clear_refs");
+   if (refs.open(QIODevice::WriteOnly))
+      refs.write("5");
+}
+
+//----------------------------------------------------------------------
+static qint64 peakKB()
+{
+   QFile status("/proc/self/status");
+   if (status.open(QIODevice::ReadOnly | QIODevice::Text))
+   {
+      for (QByteArray line = status.readLine(); !line.isEmpty(); line = status.readLine())
+      {
+         if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').front().toLongLong();
+      }
+   }
+
+#ifndef _WIN32
+   rusage usage {};
+   getrusage(RUSAGE_SELF, &usage);
+
+#ifdef __APPLE__
+   return usage.ru_maxrss / 1024;
+#else
+   return usage.ru_maxrss;
+#endif
+#else
+   return -1;
+#endif
+}
+
+//----------------------------------------------------------------------
+static void report(const char* operation_, const Context& context_, qint64 elements_, double ms_)
+{
+   QJsonObject result {
+      { "version",      CATEDITOR_VERSION },
+      { "operation",    operation_ },
+      { "size",         context_.size },
+      { "nodes",        context_.nodes },
+      { "arrows",       context_.arrows },
+      { "elements",     elements_ },
+      { "ms",           ms_ },
+      { "per_second",   ms_ > 0.0 ? elements_ * 1000.0 / ms_ : 0.0 },
+      { "peak_rss_kb",  peakKB() } };
+
+   printf("%s\n", QJsonDocument(result).toJson(QJsonDocument::Compact).constData());
+   fflush(stdout);
+}
+
+//----------------------------------------------------------------------
+template <typename TFn>
+static double measure(const TFn& fn_)
+{
+   resetPeak();
+
+   QElapsedTimer clock;
+   clock.start();
+
+   fn_();
+
+   return clock.nsecsElapsed() / 1e6;
+}
+
+//----------------------------------------------------------------------
+template <typename TFn>
+static void measure(const char* operation_, const Context& context_, qint64 elements_, const TFn& fn_)
+{
+   double ms = measure(fn_);
+
+   report(operation_, context_, elements_, ms);
+}
+
+//----------------------------------------------------------------------
+// Moves a selection the way QGraphicsItem does on mouse moves, the release
+// commits the new positions to the model
+static void drag(Scene& scene_, const std::vector<CNode*>& nodes_)
+{
+   for (int step = 1; step <= drag_steps; ++step)
+   {
+      for (CNode* pNode : nodes_)
+         pNode->setPos(pNode->pos() + QPointF(1.0, 1.0));
+   }
+
+   QGraphicsSceneMouseEvent release(QEvent::GraphicsSceneMouseRelease);
+   release.setButton(Qt::LeftButton);
+
+   QCoreApplication::sendEvent(&scene_, &release);
+}
+
+//----------------------------------------------------------------------
+static int runSize(const generator::Spec& spec_, const QString& filter_)
+{
+   QTemporaryDir dir;
+   if (!dir.isValid())
+      return 1;
+
+   const QString source = dir.filePath("source.dat");
+   const QString target = dir.filePath("target.dat");
+
+   if (!generator::Write(spec_, source.toStdString()))
+      return 1;
+
+   Scene scene;
+
+   Context context;
+   context.size = (qint64)spec_.nodes;
+
+   bool ok {};
+
+   measure("LoadBinary", context, context.size, [&]() { ok = scene.LoadBinary(source); });
+
+   if (!ok)
+      return 1;
+
+   context.nodes  = scene.CountNodes();
+   context.arrows = scene.CountArrows();
+
+   const qint64 elements = context.nodes + context.arrows;
+
+   measure("SaveBinary",      context, elements,      [&]() { scene.SaveBinary(target); });
+   measure("ChangeLabel",     context, context.nodes, [&]() { scene.ChangeLabel("p0"); });
+   measure("Filter",          context, context.nodes, [&]() { scene.Filter(filter_); });
+
+   scene.Filter("");
+
+   measure("GetDescription",  context, context.nodes, [&]() { scene.GetDescription(); });
+
+   std::vector<CNode*> selection;
+
+   for (QGraphicsItem* pItem : scene.items())
+   {
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+         selection.push_back(pNode);
+
+      if (selection.size() == drag_max_nodes)
+         break;
+   }
+
+   measure("Drag", context, (qint64)selection.size() * drag_steps, [&]() { drag(scene, selection); });
+
+   return 0;
+}
+
+//----------------------------------------------------------------------
+static int runText(const QString& path_)
+{
+   Scene scene;
+
+   bool ok {};
+
+   // Counts are only known once the file is built
+   double ms = measure([&]() { ok = scene.Build(path_); });
+
+   if (!ok)
+   {
+      fprintf(stderr, "%s: could not be built\n", qPrintable(path_));
+      return 1;
+   }
+
+   Context context;
+   context.nodes  = scene.CountNodes();
+   context.arrows = scene.CountArrows();
+   context.size   = context.nodes;
+
+   report("Build", context, context.nodes + context.arrows, ms);
+
+   return 0;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+
+   QApplication app(argc, argv);
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription("Scene operation benchmarks on synthetic categories.");
+   parser.addHelpOption();
+
+   QCommandLineOption sizes      ("sizes",      "Node counts, comma separated.", "list", "1000,10000,100000,1000000");
+   QCommandLineOption density    ("density",    "Arrows per node.", "count", "2");
+   QCommandLineOption properties ("properties", "Properties per node.", "count", "4");
+   QCommandLineOption types      ("types",      "Property types cycled through: i int, d double, f float, s string.", "types", "ids");
+   QCommandLineOption filter     ("filter",     "Filter expression.", "expression", "p0 < 50");
+   QCommandLineOption text       ("text",       "Cat text file to measure Build on.", "path");
+   QCommandLineOption worker     ("worker",     "Run in this process.");
+
+   parser.addOptions({ sizes, density, properties, types, filter, text, worker });
+
+   parser.process(app);
+
+   if (parser.isSet(worker))
+   {
+      if (parser.isSet(text))
+         return runText(parser.value(text));
+
+      generator::Spec spec;
+      spec.nodes        = parser.value(sizes).toULongLong();
+      spec.density      = parser.value(density).toDouble();
+      spec.properties   = parser.value(properties).toULongLong();
+      spec.types        = parser.value(types).toStdString();
+
+      return runSize(spec, parser.value(filter));
+   }
+
+   QStringList common {
+      "--worker",
+      "--density",      parser.value(density),
+      "--properties",   parser.value(properties),
+      "--types",        parser.value(types),
+      "--filter",       parser.value(filter) };
+
+   std::vector<QStringList> runs;
+
+   for (const QString& size : parser.value(sizes).split(',', QString::SkipEmptyParts))
+      runs.push_back(common + QStringList{ "--sizes", size.trimmed() });
+
+   if (parser.isSet(text))
+      runs.push_back(common + QStringList{ "--text", parser.value(text) });
+
+   int status {};
+
+   // One after the other, concurrent runs would skew each other
+   for (const QStringList& arguments : runs)
+   {
+      QProcess run;
+      run.setProcessChannelMode(QProcess::ForwardedChannels);
+      run.start(QCoreApplication::applicationFilePath(), arguments);
+
+      if (!run.waitForFinished(-1) || run.exitStatus() != QProcess::NormalExit || run.exitCode() != 0)
+      {
+         fprintf(stderr, "run %s failed\n", qPrintable(arguments.join(' ')));
+         status = 1;
+      }
+   }
+
+   return status;
+}
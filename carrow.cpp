@@ -1,15 +1,12 @@
 #include "carrow.h"
 #include "common.h"
 #include "cnode.h"
+#include "renderpass.h"
 
-#ifdef WIN32
-#include <corecrt_math_defines.h>
-#else
-#include <cmath>
-#endif
+#include <algorithm>
 
 #include <QPainterPath>
-#include <QVector2D>
+#include <QStyleOptionGraphicsItem>
 
 //----------------------------------------------------------------------
 CArrow::CArrow(CNode* pSource_, CNode* pTarget_, const QString& name_) :
@@ -23,12 +20,6 @@ CArrow::CArrow(CNode* pSource_, CNode* pTarget_, const QString& name_) :
    m_pSource->AddChild(this);
    m_pTarget->AddChild(this);
 
-   m_head.moveTo(0, 0);
-   m_head.lineTo(-arrow_head_size, -arrow_head_size * 0.125);
-   m_head.lineTo(-arrow_head_size,  arrow_head_size * 0.125);
-   m_head.lineTo(0, 0);
-   m_head.closeSubpath();
-
    UpdatePosition();
 }
 
@@ -53,27 +44,43 @@ void CArrow::DeInit()
 //----------------------------------------------------------------------
 QRectF CArrow::boundingRect() const
 {
-   return QRectF(
-            std::min(m_x1, m_x2) - arrow_head_size, std::min(m_y1, m_y2) - arrow_head_size,
-            std::max(m_x1, m_x2) + arrow_head_size, std::max(m_y1, m_y2) + arrow_head_size);
+   return m_bounds;
 }
 
 //----------------------------------------------------------------------
-void CArrow::paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_)
+QPainterPath CArrow::shape() const
 {
-   pPainter_->setPen(m_pen);
-   pPainter_->drawLine(m_x1, m_y1, m_x2, m_y2);
+   if (!m_shapeValid)
+   {
+      QPainterPath line(m_line.p1());
+      line.lineTo(m_line.p2());
+
+      QPainterPathStroker stroker;
+      stroker.setWidth(std::max<qreal>(m_pen.widthF(), arrow_pick_width));
 
-   QVector2D dir = QVector2D(m_x2 - m_x1, m_y2 - m_y1).normalized();
+      m_shape = stroker.createStroke(line);
+      m_shape.addPolygon(m_head);
 
-   qreal tetha = std::atan2(dir.y(), dir.x()) * 180.0 / M_PI;
+      m_shapeValid = true;
+   }
+
+   return m_shape;
+}
+
+//----------------------------------------------------------------------
+void CArrow::paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_)
+{
+   if (render::Skip(this))
+      return;
 
-   pPainter_->translate(m_x2, m_y2);
-   pPainter_->translate(-dir.x() * blob_radius, -dir.y() * blob_radius);
-   pPainter_->rotate(tetha);
+   pPainter_->setPen(m_pen);
+   pPainter_->drawLine(m_line);
 
-   pPainter_->fillPath(m_head, Qt::darkGray);
-   pPainter_->drawPath(m_head);
+   if (!m_head.isEmpty() && QStyleOptionGraphicsItem::levelOfDetailFromTransform(pPainter_->worldTransform()) >= head_min_lod)
+   {
+      pPainter_->setBrush(Qt::darkGray);
+      pPainter_->drawPolygon(m_head);
+   }
 }
 
 //----------------------------------------------------------------------
@@ -81,17 +88,56 @@ void CArrow::UpdatePosition()
 {
    prepareGeometryChange();
 
-   auto source_pos = m_pSource->sceneBoundingRect().center();
-   m_x1 = source_pos.x();
-   m_y1 = source_pos.y();
+   m_line = QLineF(m_pSource->sceneBoundingRect().center(), m_pTarget->sceneBoundingRect().center());
+
+   m_head = Head(m_line);
 
-   auto target_pos = m_pTarget->sceneBoundingRect().center();
-   m_x2 = target_pos.x();
-   m_y2 = target_pos.y();
+   qreal margin = std::max<qreal>(m_pen.widthF(), arrow_pick_width) * 0.5;
+
+   m_bounds = QRectF(m_line.p1(), m_line.p2()).normalized().united(m_head.boundingRect())
+         .adjusted(-margin, -margin, margin, margin);
+
+   m_shapeValid = false;
 
    update();
 }
 
+//----------------------------------------------------------------------
+QPolygonF CArrow::Head(const QLineF& line_)
+{
+   QPolygonF head;
+
+   qreal length = line_.length();
+
+   // Head tip sits on the target blob's outline, pointing along the line
+   if (length > 0.0)
+   {
+      QPointF dir    = (line_.p2() - line_.p1()) / length;
+      QPointF normal = QPointF(-dir.y(), dir.x());
+
+      QPointF tip    = line_.p2() - dir * blob_radius;
+      QPointF base   = tip - dir * arrow_head_size;
+
+      head << tip
+           << base + normal * arrow_head_size * 0.125
+           << base - normal * arrow_head_size * 0.125;
+   }
+
+   return head;
+}
+
+//----------------------------------------------------------------------
+CNode* CArrow::Source() const
+{
+   return m_pSource;
+}
+
+//----------------------------------------------------------------------
+CNode* CArrow::Target() const
+{
+   return m_pTarget;
+}
+
 //----------------------------------------------------------------------
 void CArrow::SetVisibility(bool visible_)
 {
@@ -3,6 +3,7 @@
 
 #include <QGraphicsItem>
 #include <QPainter>
+#include <QPainterPath>
 
 class CNode;
 
@@ -18,16 +19,30 @@ public:
    void UpdatePosition();
    void SetVisibility(bool visible_);
 
+   CNode* Source() const;
+   CNode* Target() const;
+
+   // Head polygon in the line's coordinates, empty for a zero length line
+   static QPolygonF Head(const QLineF& line_);
+
 protected:
    QRectF boundingRect() const override;
+   QPainterPath shape() const override;
    void paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_) override;
 
 private:
    CNode* m_pSource {};
    CNode* m_pTarget {};
-   qreal m_x1 {}, m_y1 {}, m_x2 {}, m_y2 {};
    QPen  m_pen;
-   QPainterPath m_head;
+
+   // Geometry in scene coordinates, recomputed by UpdatePosition only
+   QLineF               m_line;
+   QPolygonF            m_head;
+   QRectF               m_bounds;
+
+   // Picking outline, built on first use after a move
+   mutable QPainterPath m_shape;
+   mutable bool         m_shapeValid {};
 };
 
 #endif
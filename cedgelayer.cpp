@@ -0,0 +1,453 @@
+#include "cedgelayer.h"
+#include "carrow.h"
+#include "cnode.h"
+#include "common.h"
+#include "renderpass.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+// Grid resolution along each side of the scene
+static const int     grid_size      = 40;
+static const double  cell_size      = double(scene_size) / grid_size;
+
+//----------------------------------------------------------------------
+static qreal distance(const QLineF& line_, const QPointF& pos_)
+{
+   QPointF d   = line_.p2() - line_.p1();
+   qreal   len = d.x() * d.x() + d.y() * d.y();
+
+   qreal t = len > 0.0 ? QPointF::dotProduct(pos_ - line_.p1(), d) / len : 0.0;
+   t = std::clamp(t, 0.0, 1.0);
+
+   QPointF closest = line_.p1() + d * t;
+
+   return std::hypot(pos_.x() - closest.x(), pos_.y() - closest.y());
+}
+
+//----------------------------------------------------------------------
+CEdgeLayer::CEdgeLayer() :
+      m_grid   (grid_size * grid_size)
+   ,  m_bounds (0, 0, scene_size, scene_size)
+   ,  m_pen    (QColor(Qt::darkGray), Qt::SolidLine)
+{
+   setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+   setAcceptedMouseButtons(Qt::NoButton);
+}
+
+//----------------------------------------------------------------------
+int CEdgeLayer::Add(CNode* pSource_, CNode* pTarget_, const QString& name_)
+{
+   int edge {};
+
+   if (!m_free.empty())
+   {
+      edge = m_free.back();
+      m_free.pop_back();
+   }
+   else
+   {
+      edge = (int)m_edges.size();
+
+      m_edges  .emplace_back();
+      m_lines  .emplace_back();
+      m_heads  .emplace_back();
+      m_visited.push_back(0);
+   }
+
+   m_edges[edge].pSource = pSource_;
+   m_edges[edge].pTarget = pTarget_;
+   m_edges[edge].name    = name_;
+
+   m_names.insert(name_, edge);
+
+   m_incident[pSource_].push_back(edge);
+   if (pTarget_ != pSource_)
+      m_incident[pTarget_].push_back(edge);
+
+   place(edge);
+
+   return edge;
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::Remove(int edge_)
+{
+   if (edge_ < 0 || edge_ >= (int)m_edges.size() || !m_edges[edge_].pSource)
+      return;
+
+   Edge& edge = m_edges[edge_];
+
+   unplace(edge_);
+
+   for (CNode* pNode : { edge.pSource, edge.pTarget })
+   {
+      auto it = m_incident.find(pNode);
+      if (it == m_incident.end())
+         continue;
+
+      auto& incident = it.value();
+      incident.erase(std::remove(incident.begin(), incident.end(), edge_), incident.end());
+
+      if (incident.empty())
+         m_incident.erase(it);
+   }
+
+   auto it = m_names.find(edge.name);
+   if (it != m_names.end() && it.value() == edge_)
+      m_names.erase(it);
+
+   edge = Edge();
+
+   m_lines[edge_] = QLineF();
+   m_heads[edge_].clear();
+
+   m_free.push_back(edge_);
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::RemoveNode(CNode* pNode_)
+{
+   for (int edge : Incident(pNode_))
+      Remove(edge);
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::NodeMoved(CNode* pNode_)
+{
+   auto it = m_incident.find(pNode_);
+   if (it == m_incident.end())
+      return;
+
+   for (int edge : it.value())
+   {
+      unplace(edge);
+      place  (edge);
+   }
+}
+
+//----------------------------------------------------------------------
+int CEdgeLayer::Find(const QString& name_) const
+{
+   return m_names.value(name_, npos);
+}
+
+//----------------------------------------------------------------------
+int CEdgeLayer::EdgeAt(const QPointF& pos_, qreal tolerance_) const
+{
+   int   found    = npos;
+   qreal nearest  = tolerance_ + m_pen.widthF() * 0.5;
+
+   QRectF area(pos_.x() - nearest, pos_.y() - nearest, nearest * 2.0, nearest * 2.0);
+
+   forEdges(area, [&](int edge_)
+   {
+      const Edge& edge = m_edges[edge_];
+
+      if (!edge.pSource->isVisible() || !edge.pTarget->isVisible())
+         return;
+
+      qreal d = m_heads[edge_].containsPoint(pos_, Qt::OddEvenFill) ? 0.0 : distance(m_lines[edge_], pos_);
+
+      if (d <= nearest)
+      {
+         nearest  = d;
+         found    = edge_;
+      }
+   });
+
+   return found;
+}
+
+//----------------------------------------------------------------------
+int CEdgeLayer::Slots() const
+{
+   return (int)m_edges.size();
+}
+
+//----------------------------------------------------------------------
+CNode* CEdgeLayer::Source(int edge_) const
+{
+   return m_edges[edge_].pSource;
+}
+
+//----------------------------------------------------------------------
+CNode* CEdgeLayer::Target(int edge_) const
+{
+   return m_edges[edge_].pTarget;
+}
+
+//----------------------------------------------------------------------
+QString CEdgeLayer::Name(int edge_) const
+{
+   return m_edges[edge_].name;
+}
+
+//----------------------------------------------------------------------
+QRectF CEdgeLayer::Bounds(int edge_) const
+{
+   const QLineF& line = m_lines[edge_];
+
+   qreal margin = std::max<qreal>(m_pen.widthF(), arrow_pick_width) * 0.5;
+
+   return QRectF(line.p1(), line.p2()).normalized().united(m_heads[edge_].boundingRect())
+         .adjusted(-margin, -margin, margin, margin);
+}
+
+//----------------------------------------------------------------------
+std::vector<int> CEdgeLayer::Incident(CNode* pNode_) const
+{
+   return m_incident.value(pNode_);
+}
+
+//----------------------------------------------------------------------
+QRectF CEdgeLayer::boundingRect() const
+{
+   return m_bounds;
+}
+
+//----------------------------------------------------------------------
+QPainterPath CEdgeLayer::shape() const
+{
+   // Picking goes through EdgeAt, the layer never takes mouse events itself
+   return QPainterPath();
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_)
+{
+   std::vector<int> edges;
+
+   forEdges(pOption_->exposedRect, [&](int edge_)
+   {
+      const Edge& edge = m_edges[edge_];
+
+      // Edges of dragged nodes are painted live, the rest into the view's tiles
+      if (render::pass != render::EPass::eAll && !render::Paints(render::IsLive(edge.pSource) || render::IsLive(edge.pTarget)))
+         return;
+
+      edges.push_back(edge_);
+   });
+
+   paintEdges(pPainter_, edges);
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::PaintIncident(QPainter* pPainter_, const std::vector<CNode*>& nodes_) const
+{
+   if (++m_pass == 0)
+   {
+      std::fill(m_visited.begin(), m_visited.end(), 0);
+      m_pass = 1;
+   }
+
+   std::vector<int> edges;
+
+   for (CNode* pNode : nodes_)
+   {
+      auto it = m_incident.find(pNode);
+      if (it == m_incident.end())
+         continue;
+
+      for (int edge : it.value())
+      {
+         if (m_visited[edge] == m_pass)
+            continue;
+
+         m_visited[edge] = m_pass;
+
+         edges.push_back(edge);
+      }
+   }
+
+   paintEdges(pPainter_, edges);
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::paintEdges(QPainter* pPainter_, const std::vector<int>& edges_) const
+{
+   bool heads = QStyleOptionGraphicsItem::levelOfDetailFromTransform(pPainter_->worldTransform()) >= head_min_lod;
+
+   QVector<QLineF>   lines;
+   QPainterPath      path;
+
+   for (int edge : edges_)
+   {
+      if (!m_edges[edge].pSource->isVisible() || !m_edges[edge].pTarget->isVisible())
+         continue;
+
+      lines.push_back(m_lines[edge]);
+
+      if (heads && !m_heads[edge].isEmpty())
+         path.addPolygon(m_heads[edge]);
+   }
+
+   pPainter_->setPen(m_pen);
+   pPainter_->drawLines(lines);
+
+   if (!path.isEmpty())
+   {
+      pPainter_->setBrush(Qt::darkGray);
+      pPainter_->drawPath(path);
+   }
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::place(int edge_)
+{
+   Edge& edge = m_edges[edge_];
+
+   QLineF line(edge.pSource->sceneBoundingRect().center(), edge.pTarget->sceneBoundingRect().center());
+
+   m_lines[edge_] = line;
+   m_heads[edge_] = CArrow::Head(line);
+
+   QRectF rect = Bounds(edge_);
+
+   collectCells(edge_, edge.cells);
+
+   for (int cell : edge.cells)
+      m_grid[cell].push_back(edge_);
+
+   if (!m_bounds.contains(rect))
+   {
+      prepareGeometryChange();
+      m_bounds |= rect;
+   }
+
+   update(rect);
+}
+
+//----------------------------------------------------------------------
+void CEdgeLayer::unplace(int edge_)
+{
+   Edge& edge = m_edges[edge_];
+
+   for (int index : edge.cells)
+   {
+      auto& cell = m_grid[index];
+
+      auto it = std::find(cell.begin(), cell.end(), edge_);
+      if (it != cell.end())
+      {
+         *it = cell.back();
+         cell.pop_back();
+      }
+   }
+
+   edge.cells.clear();
+
+   update(Bounds(edge_));
+}
+
+//----------------------------------------------------------------------
+// Walks the segment from cell border to cell border. Each piece of it,
+// widened by the pick margin, covers one cell or, next to a border, a few,
+// so a long diagonal edge takes a line of cells instead of its whole
+// bounding rect.
+void CEdgeLayer::collectCells(int edge_, std::vector<int>& cells_) const
+{
+   cells_.clear();
+
+   const QLineF& line = m_lines[edge_];
+
+   qreal margin = std::max<qreal>(m_pen.widthF(), arrow_pick_width) * 0.5;
+
+   auto add = [&](const QRectF& rect_)
+   {
+      QRect range = cellRange(rect_.adjusted(-margin, -margin, margin, margin));
+
+      for (int y = range.top(); y <= range.bottom(); ++y)
+      {
+         for (int x = range.left(); x <= range.right(); ++x)
+            cells_.push_back(y * grid_size + x);
+      }
+   };
+
+   // Parameter along the line of the next vertical and horizontal border
+   // crossing, and the parameter distance between two crossings
+   auto crossing = [](qreal from_, qreal delta_, qreal& next_, qreal& step_)
+   {
+      if (delta_ == 0.0)
+      {
+         next_ = step_ = std::numeric_limits<qreal>::infinity();
+         return;
+      }
+
+      qreal border = delta_ > 0.0 ? (std::floor(from_ / cell_size) + 1.0) * cell_size : std::ceil(from_ / cell_size - 1.0) * cell_size;
+
+      next_ = (border - from_) / delta_;
+      step_ = cell_size / std::abs(delta_);
+   };
+
+   qreal nextX {}, stepX {}, nextY {}, stepY {};
+
+   crossing(line.p1().x(), line.dx(), nextX, stepX);
+   crossing(line.p1().y(), line.dy(), nextY, stepY);
+
+   for (qreal t = 0.0; ; )
+   {
+      qreal next = std::min({ nextX, nextY, 1.0 });
+
+      add(QRectF(line.pointAt(t), line.pointAt(next)).normalized());
+
+      if (next >= 1.0)
+         break;
+
+      if (nextX <= nextY)
+         nextX += stepX;
+      else
+         nextY += stepY;
+
+      t = next;
+   }
+
+   add(m_heads[edge_].boundingRect());
+
+   std::sort(cells_.begin(), cells_.end());
+   cells_.erase(std::unique(cells_.begin(), cells_.end()), cells_.end());
+}
+
+//----------------------------------------------------------------------
+QRect CEdgeLayer::cellRange(const QRectF& rect_) const
+{
+   auto cell = [](qreal coord_)
+   {
+      return std::clamp(int(std::floor(coord_ / cell_size)), 0, grid_size - 1);
+   };
+
+   return QRect(QPoint(cell(rect_.left()), cell(rect_.top())), QPoint(cell(rect_.right()), cell(rect_.bottom())));
+}
+
+//----------------------------------------------------------------------
+template <typename TFn>
+void CEdgeLayer::forEdges(const QRectF& rect_, const TFn& fn_) const
+{
+   if (++m_pass == 0)
+   {
+      std::fill(m_visited.begin(), m_visited.end(), 0);
+      m_pass = 1;
+   }
+
+   QRect cells = cellRange(rect_);
+
+   for (int y = cells.top(); y <= cells.bottom(); ++y)
+   {
+      for (int x = cells.left(); x <= cells.right(); ++x)
+      {
+         for (int edge : m_grid[y * grid_size + x])
+         {
+            if (m_visited[edge] == m_pass)
+               continue;
+
+            m_visited[edge] = m_pass;
+
+            fn_(edge);
+         }
+      }
+   }
+}
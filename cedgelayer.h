@@ -0,0 +1,94 @@
+#ifndef CEDGELAYER_H
+#define CEDGELAYER_H
+
+#include <vector>
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPen>
+
+class CNode;
+
+// All arrows of a scene drawn by one item. Segment endpoints live in one
+// contiguous buffer, paint batches the visible ones into a few drawLines
+// calls. A uniform grid over the scene serves both paint culling and per
+// edge picking, only the segments of a moved node are updated.
+class CEdgeLayer : public QGraphicsItem
+{
+public:
+   static constexpr int npos = -1;
+
+   CEdgeLayer();
+
+   int  Add(CNode* pSource_, CNode* pTarget_, const QString& name_);
+   void Remove(int edge_);
+   void RemoveNode(CNode* pNode_);
+   void NodeMoved(CNode* pNode_);
+
+   int Find(const QString& name_) const;
+
+   // Edge under the scene position or npos
+   int EdgeAt(const QPointF& pos_, qreal tolerance_) const;
+
+   // Edge slots, removed ones have no source
+   int Slots() const;
+   CNode* Source(int edge_) const;
+   CNode* Target(int edge_) const;
+   QString Name(int edge_) const;
+   QRectF Bounds(int edge_) const;
+
+   // Edges incident to the node, in either direction
+   std::vector<int> Incident(CNode* pNode_) const;
+
+   QRectF boundingRect() const override;
+   QPainterPath shape() const override;
+   void paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_) override;
+
+   // Paints the edges incident to the nodes only, each once, for the view
+   // to draw the edges of dragged nodes over its cached tiles
+   void PaintIncident(QPainter* pPainter_, const std::vector<CNode*>& nodes_) const;
+
+private:
+   struct Edge
+   {
+      CNode*   pSource  {};
+      CNode*   pTarget  {};
+      QString  name;
+
+      // Grid cells the segment and its head cross
+      std::vector<int>  cells;
+   };
+
+   void paintEdges(QPainter* pPainter_, const std::vector<int>& edges_) const;
+
+   void place(int edge_);
+   void unplace(int edge_);
+   void collectCells(int edge_, std::vector<int>& cells_) const;
+   QRect cellRange(const QRectF& rect_) const;
+
+   // Calls fn_ once for every edge registered in the cells under the rect
+   template <typename TFn>
+   void forEdges(const QRectF& rect_, const TFn& fn_) const;
+
+   std::vector<QLineF>        m_lines;
+   std::vector<QPolygonF>     m_heads;
+   std::vector<Edge>          m_edges;
+   std::vector<int>           m_free;
+
+   QHash<QString, int>        m_names;
+   QHash<const CNode*, std::vector<int>>
+                              m_incident;
+
+   std::vector<std::vector<int>>
+                              m_grid;
+
+   // Per pass marks, so that edges spanning several cells are visited once
+   mutable std::vector<uint32_t>
+                              m_visited;
+   mutable uint32_t           m_pass      {};
+
+   QRectF                     m_bounds;
+   QPen                       m_pen;
+};
+
+#endif
@@ -0,0 +1,419 @@
+// Batch conversion and queries on category files, without any window.
+//
+//    cateditor-cli [options] stats|describe|convert [files...]
+//
+// Files ending in .dat are loaded as binary, anything else is built from
+// Cat text. Records are printed as CSV or as one JSON object per file.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "filterprogram.h"
+#include "scene.h"
+
+enum class ECommand
+{
+      eStats
+   ,  eDescribe
+   ,  eConvert
+};
+
+struct Options
+{
+   ECommand    command  {};
+   bool        json     {};
+   bool        text     {};
+   bool        header   { true };
+   QString     filter;
+   QString     output;
+};
+
+//----------------------------------------------------------------------
+static void print(const QString& text_)
+{
+   fputs(text_.toUtf8().constData(), stdout);
+}
+
+//----------------------------------------------------------------------
+static QString csvField(const QString& field_)
+{
+   if (!field_.contains(',') && !field_.contains('"') && !field_.contains('\n') && !field_.contains('\r'))
+      return field_;
+
+   return '"' + QString(field_).replace("\"", "\"\"") + '"';
+}
+
+//----------------------------------------------------------------------
+static QString csvRow(const QStringList& fields_)
+{
+   QStringList row;
+
+   for (const QString& field : fields_)
+      row.push_back(csvField(field));
+
+   return row.join(',') + '\n';
+}
+
+//----------------------------------------------------------------------
+static QString jsonRow(const QJsonObject& object_)
+{
+   return QString::fromUtf8(QJsonDocument(object_).toJson(QJsonDocument::Compact)) + '\n';
+}
+
+//----------------------------------------------------------------------
+static QString csvHeader(ECommand command_)
+{
+   switch (command_)
+   {
+   case ECommand::eStats:     return csvRow({ "file", "nodes", "arrows" });
+   case ECommand::eDescribe:  return csvRow({ "file", "id", "property", "value" });
+   case ECommand::eConvert:   return csvRow({ "file", "output" });
+   }
+
+   return QString();
+}
+
+//----------------------------------------------------------------------
+static QString convertTarget(const QString& path_, const Options& options_)
+{
+   return QDir(options_.output).filePath(QFileInfo(path_).completeBaseName() + ".dat");
+}
+
+//----------------------------------------------------------------------
+// Inputs of the same base name from different directories would convert to
+// the same file, each one overwriting the last, concurrently with --jobs
+static bool uniqueTargets(const QStringList& files_, const Options& options_)
+{
+   QHash<QString, QString> sources;
+   bool unique = true;
+
+   for (const QString& path : files_)
+   {
+      const QString target = QFileInfo(convertTarget(path, options_)).absoluteFilePath();
+
+      auto it = sources.find(target);
+      if (it == sources.end())
+      {
+         sources.insert(target, path);
+         continue;
+      }
+
+      fprintf(stderr, "%s and %s both convert to %s
+", qPrintable(it.value()), qPrintable(path), qPrintable(target));
+      unique = false;
+   }
+
+   return unique;
+}
+
+//----------------------------------------------------------------------
+static bool process(Scene& scene_, const QString& path_, const Options& options_)
+{
+   scene_.New();
+
+   bool binary = !options_.text && QFileInfo(path_).suffix().compare("dat", Qt::CaseInsensitive) == 0;
+
+   if (!(binary ? scene_.LoadBinary(path_) : scene_.Build(path_)))
+   {
+      fprintf(stderr, "%s: could not be loaded\n", qPrintable(path_));
+      return false;
+   }
+
+   if (!options_.filter.isEmpty())
+      scene_.Filter(options_.filter);
+
+   switch (options_.command)
+   {
+   case ECommand::eStats:
+   {
+      if (options_.json)
+      {
+         print(jsonRow({ { "file",        path_ },
+                         { "nodes",       scene_.CountNodes() },
+                         { "arrows",      scene_.CountArrows() },
+                         { "statistics",  scene_.Statistics() } }));
+      }
+      else
+      {
+         print(csvRow({ path_, QString::number(scene_.CountNodes()), QString::number(scene_.CountArrows()) }));
+      }
+
+      break;
+   }
+
+   case ECommand::eDescribe:
+   {
+      QJsonArray records;
+
+      for (const auto& record : scene_.GetDescription())
+      {
+         if (options_.json)
+         {
+            QJsonObject object;
+
+            for (auto it = record.begin(); it != record.end(); ++it)
+               object.insert(it.key(), it.value());
+
+            records.push_back(object);
+            continue;
+         }
+
+         // Long format, so that files with different properties share a header
+         const QString id = record.value("id");
+
+         if (record.size() == 1)
+            print(csvRow({ path_, id, QString(), QString() }));
+
+         for (auto it = record.begin(); it != record.end(); ++it)
+         {
+            if (it.key() != "id")
+               print(csvRow({ path_, id, it.key(), it.value() }));
+         }
+      }
+
+      if (options_.json)
+         print(jsonRow({ { "file", path_ }, { "records", records } }));
+
+      break;
+   }
+
+   case ECommand::eConvert:
+   {
+      QString target = convertTarget(path_, options_);
+
+      if (!scene_.SaveBinary(target))
+      {
+         fprintf(stderr, "%s: could not be saved to %s\n", qPrintable(path_), qPrintable(target));
+         return false;
+      }
+
+      if (options_.json)
+         print(jsonRow({ { "file", path_ }, { "output", target } }));
+      else
+         print(csvRow({ path_, target }));
+
+      break;
+   }
+   }
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+// Splits the files over worker processes running this same tool. Each
+// worker writes to its own file, outputs are concatenated in input order.
+static int fanOut(const QStringList& files_, int jobs_, const QStringList& arguments_)
+{
+   QTemporaryDir dir;
+   if (!dir.isValid())
+   {
+      fprintf(stderr, "no temporary directory for the workers\n");
+      return 1;
+   }
+
+   const int chunk = (files_.size() + jobs_ - 1) / jobs_;
+
+   std::vector<std::unique_ptr<QProcess>> workers;
+
+   for (int first = 0; first < files_.size(); first += chunk)
+   {
+      const QString name = QString::number(workers.size());
+
+      // Thousands of paths do not fit on a command line everywhere
+      QFile list(dir.filePath(name + ".list"));
+      if (!list.open(QIODevice::WriteOnly | QIODevice::Text))
+         return 1;
+
+      list.write(files_.mid(first, chunk).join('\n').toUtf8());
+      list.close();
+
+      auto pWorker = std::make_unique<QProcess>();
+      pWorker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+      pWorker->setStandardOutputFile(dir.filePath(name + ".out"));
+      pWorker->start(QCoreApplication::applicationFilePath(),
+         arguments_ + QStringList{ "--no-header", "--files-from", list.fileName() });
+
+      workers.push_back(std::move(pWorker));
+   }
+
+   int status {};
+
+   for (size_t i = 0; i < workers.size(); ++i)
+   {
+      QProcess& worker = *workers[i];
+
+      if (!worker.waitForFinished(-1) || worker.exitStatus() != QProcess::NormalExit || worker.exitCode() != 0)
+         status = 1;
+
+      QFile output(dir.filePath(QString::number(i) + ".out"));
+      if (output.open(QIODevice::ReadOnly))
+      {
+         QByteArray data = output.readAll();
+         fwrite(data.constData(), 1, data.size(), stdout);
+      }
+   }
+
+   return status;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   // Scene is a QGraphicsScene, it needs the widgets application but never
+   // shows anything
+   if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+
+   QApplication app(argc, argv);
+   QApplication::setApplicationName("cateditor-cli");
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription("Batch conversion and queries on Cat categories.");
+   parser.addHelpOption();
+
+   parser.addPositionalArgument("command", "stats, describe or convert");
+   parser.addPositionalArgument("files", "Cat text or .dat files", "[files...]");
+
+   QCommandLineOption format     ({ "f", "format" },  "Output format, csv or json.", "format", "csv");
+   QCommandLineOption filter     ("filter",           "Filter expression applied before describe.", "expression");
+   QCommandLineOption text       ("text",             "Build every input from Cat text, whatever its suffix.");
+   QCommandLineOption output     ({ "o", "output" },  "Output directory of convert.", "directory", ".");
+   QCommandLineOption jobs       ({ "j", "jobs" },    "Worker processes, 0 for one per core.", "count", "1");
+   QCommandLineOption filesFrom  ("files-from",       "Read input paths from a file, one per line.", "path");
+   QCommandLineOption noHeader   ("no-header",        "Omit the CSV header.");
+
+   parser.addOptions({ format, filter, text, output, jobs, filesFrom, noHeader });
+
+   parser.process(app);
+
+   QStringList positional = parser.positionalArguments();
+   if (positional.isEmpty())
+      parser.showHelp(2);
+
+   Options options;
+
+   const QString command = positional.takeFirst();
+
+   if (command == "stats")
+      options.command = ECommand::eStats;
+   else if (command == "describe")
+      options.command = ECommand::eDescribe;
+   else if (command == "convert")
+      options.command = ECommand::eConvert;
+   else
+   {
+      fprintf(stderr, "unknown command %s\n", qPrintable(command));
+      return 2;
+   }
+
+   const QString fmt = parser.value(format);
+   if (fmt != "csv" && fmt != "json")
+   {
+      fprintf(stderr, "unknown format %s\n", qPrintable(fmt));
+      return 2;
+   }
+
+   options.json   = fmt == "json";
+   options.text   = parser.isSet(text);
+   options.header = !parser.isSet(noHeader);
+   options.filter = parser.value(filter);
+   options.output = parser.value(output);
+
+   // Scene::Filter only logs a bad expression, batch runs should stop
+   if (!options.filter.isEmpty())
+   {
+      try {
+         FilterProgram::Compile(options.filter.toStdString());
+      }  catch (const std::invalid_argument& arg_) {
+         fprintf(stderr, "filter: %s\n", arg_.what());
+         return 2;
+      }
+   }
+
+   if (options.command == ECommand::eConvert && !QDir().mkpath(options.output))
+   {
+      fprintf(stderr, "%s: could not be created\n", qPrintable(options.output));
+      return 2;
+   }
+
+   QStringList files = positional;
+
+   if (parser.isSet(filesFrom))
+   {
+      QFile list(parser.value(filesFrom));
+      if (!list.open(QIODevice::ReadOnly | QIODevice::Text))
+      {
+         fprintf(stderr, "%s: could not be read\n", qPrintable(list.fileName()));
+         return 2;
+      }
+
+      QTextStream stream(&list);
+      while (!stream.atEnd())
+      {
+         QString line = stream.readLine().trimmed();
+         if (!line.isEmpty())
+            files.push_back(line);
+      }
+   }
+
+   if (options.command == ECommand::eConvert && !uniqueTargets(files, options))
+      return 2;
+
+   bool ok {};
+   int workers = parser.value(jobs).toInt(&ok);
+   if (!ok || workers < 0)
+   {
+      fprintf(stderr, "invalid job count %s\n", qPrintable(parser.value(jobs)));
+      return 2;
+   }
+
+   if (workers == 0)
+      workers = QThread::idealThreadCount();
+
+   if (options.header && !options.json)
+      print(csvHeader(options.command));
+
+   if (workers > 1 && files.size() > 1)
+   {
+      QStringList arguments { command, "--format", fmt, "--output", options.output };
+
+      if (options.text)
+         arguments << "--text";
+
+      if (!options.filter.isEmpty())
+         arguments << "--filter" << options.filter;
+
+      fflush(stdout);
+
+      return fanOut(files, std::min<int>(workers, files.size()), arguments);
+   }
+
+   Scene scene;
+
+   int status {};
+
+   for (const QString& path : files)
+   {
+      if (!process(scene, path, options))
+         status = 1;
+   }
+
+   return status;
+}
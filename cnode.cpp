@@ -1,13 +1,32 @@
 #include "cnode.h"
 #include "common.h"
 #include "carrow.h"
+#include "cedgelayer.h"
+#include "renderpass.h"
 
 #include <QGraphicsScene>
 #include <QBrush>
+#include <QPainter>
 #include <QStyleOptionGraphicsItem>
 
 static const QColor select_color(150, 250, 150, 255);
 
+//----------------------------------------------------------------------
+// Node label, left out of zoomed-out views
+class CLabel : public QGraphicsTextItem
+{
+public:
+   using QGraphicsTextItem::QGraphicsTextItem;
+
+   void paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_) override
+   {
+      if (render::Skip(this) || QStyleOptionGraphicsItem::levelOfDetailFromTransform(pPainter_->worldTransform()) < label_min_lod)
+         return;
+
+      QGraphicsTextItem::paint(pPainter_, pOption_, pWidget_);
+   }
+};
+
 //----------------------------------------------------------------------
 CNode::CNode(qreal x_, qreal y_, const QString& name_)
 {
@@ -21,12 +40,12 @@ CNode::CNode(qreal x_, qreal y_, const QString& name_)
    setFlag(QGraphicsItem::ItemSendsGeometryChanges);
    setFlag(QGraphicsItem::ItemSendsScenePositionChanges);
 
-   QBrush brush(QColor(Qt::lightGray), Qt::SolidPattern);
+   QBrush brush(QColor(Qt::gray), Qt::SolidPattern);
 
    setBrush (brush);
    setZValue(blob_layer);
 
-   m_pText = new QGraphicsTextItem(name_);
+   m_pText = new CLabel(name_);
 
    m_pText->setPos(QPointF(blob_radius, 0));
    m_pText->setParentItem(this);
@@ -46,6 +65,9 @@ void CNode::Init()
 //----------------------------------------------------------------------
 void CNode::DeInit()
 {
+   if (m_pEdges)
+      m_pEdges->RemoveNode(this);
+
    auto backup = m_children;
 
    for (auto& arrow : backup)
@@ -64,12 +86,20 @@ QVariant CNode::itemChange(GraphicsItemChange change_, const QVariant& value_)
       for (auto& arrow : m_children)
          arrow->UpdatePosition();
 
+      if (m_pEdges)
+         m_pEdges->NodeMoved(this);
+
       emit positionChanged(this);
    }
 
-   QBrush br = brush();
-   br.setColor(isSelected() ? select_color : Qt::GlobalColor::gray);
-   setBrush(br);
+   if (change_ == ItemSelectedHasChanged)
+   {
+      QBrush br = brush();
+      br.setColor(isSelected() ? select_color : Qt::GlobalColor::gray);
+      setBrush(br);
+
+      emit selectedChanged(this);
+   }
 
    return QGraphicsEllipseItem::itemChange(change_, value_);
 }
@@ -77,6 +107,20 @@ QVariant CNode::itemChange(GraphicsItemChange change_, const QVariant& value_)
 //----------------------------------------------------------------------
 void CNode::paint(QPainter* pPainter_, const QStyleOptionGraphicsItem* pOption_, QWidget* pWidget_)
 {
+   if (render::Skip(this))
+      return;
+
+   // Zoomed out a node is a single point of its fill color
+   if (QStyleOptionGraphicsItem::levelOfDetailFromTransform(pPainter_->worldTransform()) < node_min_lod)
+   {
+      QPen pen(brush().color(), 3.0);
+      pen.setCosmetic(true);
+
+      pPainter_->setPen(pen);
+      pPainter_->drawPoint(QPointF(0, 0));
+      return;
+   }
+
    QStyleOptionGraphicsItem opt = *pOption_;
    opt.state.setFlag(QStyle::State_Selected, false);
 
@@ -110,6 +154,18 @@ void CNode::SetVisibility(bool visible_)
       pArrow->SetVisibility(visible_);
 }
 
+//----------------------------------------------------------------------
+void CNode::SetEdgeLayer(CEdgeLayer* pLayer_)
+{
+   m_pEdges = pLayer_;
+}
+
+//----------------------------------------------------------------------
+CEdgeLayer* CNode::EdgeLayer() const
+{
+   return m_pEdges;
+}
+
 //----------------------------------------------------------------------
 void CNode::SetText(const QString& text_)
 {
@@ -5,6 +5,7 @@
 #include <set>
 
 class CArrow;
+class CEdgeLayer;
 
 class CNode : public QObject,  public QGraphicsEllipseItem
 {
@@ -22,11 +23,16 @@ public:
    void RemoveChild(CArrow* pArrow_);
    void SetVisibility(bool visible_);
 
+   // Layer drawing the node's arrows when they are not items of their own
+   void SetEdgeLayer(CEdgeLayer* pLayer_);
+   CEdgeLayer* EdgeLayer() const;
+
    void SetText(const QString& text_);
    QString GetText() const;
 
 signals:
    void positionChanged(const CNode*);
+   void selectedChanged(CNode*);
 
 protected:
    QVariant itemChange(GraphicsItemChange change_, const QVariant& value_) override;
@@ -35,6 +41,7 @@ protected:
 private:
    std::set<CArrow*>    m_children;
    QGraphicsTextItem*   m_pText     {};
+   CEdgeLayer*          m_pEdges    {};
 };
 
 #endif
@@ -7,6 +7,9 @@
 // Node data
 constexpr int eID = Qt::UserRole + 0;
 
+// Set while the item is being dragged, see renderpass.h
+constexpr int eLive = Qt::UserRole + 1;
+
 //----------------------------------------------------------------------
 static const double  blob_radius       = 20.0;
 static const int     blob_layer        = 2;
@@ -14,9 +17,15 @@ static const int     blob_layer        = 2;
 static const int     label_layer       = 1;
 
 static const double  arrow_head_size   = blob_radius * 1.0;
+static const double  arrow_pick_width  = 4.0;
 
 static const int     scene_size        = 10000;
 
+// Level of detail thresholds, the view scale below which details are dropped
+static const double  label_min_lod     = 0.4;
+static const double  head_min_lod      = 0.25;
+static const double  node_min_lod      = 0.1;
+
 static const QStringList cat_types = {{"Double"},{"Float"},{"Int"},{"String"}};
 
 #endif
@@ -4,7 +4,7 @@
 
 //----------------------------------------------------------------------
 CTable::CTable(QWidget* pParent_) :
-   QTableWidget(pParent_)
+   QTableView(pParent_)
 {
 }
 
@@ -16,7 +16,7 @@ CTable::~CTable()
 //----------------------------------------------------------------------
 void CTable::keyPressEvent(QKeyEvent* pEvent_)
 {
-   QTableWidget::keyPressEvent(pEvent_);
+   QTableView::keyPressEvent(pEvent_);
 
    emit KeyPressed(pEvent_);
 }
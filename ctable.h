@@ -1,9 +1,9 @@
 #ifndef CTABLE_H
 #define CTABLE_H
 
-#include <QTableWidget>
+#include <QTableView>
 
-class CTable : public QTableWidget
+class CTable : public QTableView
 {
    Q_OBJECT
 
@@ -0,0 +1,453 @@
+#include "datfile.h"
+
+#include <cstring>
+#include <unordered_map>
+
+using namespace cat;
+
+static const char     magic[4]       = {'C', 'A', 'T', 'D'};
+static const size_t   header_size    = sizeof(magic) + 5 * sizeof(uint32_t) + sizeof(uint64_t);
+static const size_t   arrow_size     = 5 * sizeof(uint32_t);
+static const size_t   property_size  = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+//----------------------------------------------------------------------
+static uint32_t get_u32(const unsigned char* pData_)
+{
+   return  uint32_t(pData_[0])        | (uint32_t(pData_[1]) << 8) |
+          (uint32_t(pData_[2]) << 16) | (uint32_t(pData_[3]) << 24);
+}
+
+//----------------------------------------------------------------------
+static uint64_t get_u64(const unsigned char* pData_)
+{
+   return uint64_t(get_u32(pData_)) | (uint64_t(get_u32(pData_ + 4)) << 32);
+}
+
+//----------------------------------------------------------------------
+static void put_u32(std::string& out_, uint32_t value_)
+{
+   char bytes[4] = { char(value_), char(value_ >> 8), char(value_ >> 16), char(value_ >> 24) };
+   out_.append(bytes, sizeof(bytes));
+}
+
+//----------------------------------------------------------------------
+static void put_u64(std::string& out_, uint64_t value_)
+{
+   put_u32(out_, uint32_t(value_));
+   put_u32(out_, uint32_t(value_ >> 32));
+}
+
+//----------------------------------------------------------------------
+// Bounds checked cursor over the v1 layout
+class V1Reader
+{
+public:
+   V1Reader(const char* pData_, size_t size_) : m_pData(pData_), m_size(size_) {}
+
+   template <typename T>
+   bool Get(T& value_)
+   {
+      if (m_size - m_pos < sizeof(T))
+         return false;
+
+      std::memcpy(&value_, m_pData + m_pos, sizeof(T));
+      m_pos += sizeof(T);
+
+      return true;
+   }
+
+   bool Get(std::string_view& str_)
+   {
+      size_t sz{};
+      if (!Get(sz) || m_size - m_pos < sz)
+         return false;
+
+      str_ = std::string_view(m_pData + m_pos, sz);
+      m_pos += sz;
+
+      return true;
+   }
+
+private:
+   const char* m_pData {};
+   size_t      m_size  {};
+   size_t      m_pos   {};
+};
+
+//----------------------------------------------------------------------
+static bool read_v1(const char* pData_, size_t size_, dat::Document& doc_)
+{
+   V1Reader reader(pData_, size_);
+
+   size_t node_count{};
+   if (!reader.Get(node_count))
+      return false;
+
+   for (size_t i = 0; i < node_count; ++i)
+   {
+      std::string_view name;
+      if (!reader.Get(name))
+         return false;
+
+      doc_.nodes.push_back(name);
+   }
+
+   size_t arrow_count{};
+   if (!reader.Get(arrow_count))
+      return false;
+
+   for (size_t i = 0; i < arrow_count; ++i)
+   {
+      dat::Arrow arrow;
+      if (!reader.Get(arrow.name) || !reader.Get(arrow.source) || !reader.Get(arrow.target))
+         return false;
+
+      size_t prop_count{};
+      if (!reader.Get(prop_count))
+         return false;
+
+      arrow.first_property = (uint32_t)doc_.properties.size();
+      arrow.property_count = (uint32_t)prop_count;
+
+      for (size_t j = 0; j < prop_count; ++j)
+      {
+         dat::Property prop;
+
+         size_t type_ind{};
+         if (!reader.Get(prop.name) || !reader.Get(type_ind))
+            return false;
+
+         prop.type = (ESetTypes)type_ind;
+
+         bool ok = false;
+         if (type_ind == (size_t)ESetTypes::eDouble)
+         {
+            double val{};
+            ok = reader.Get(val);
+            prop.number = val;
+         }
+         else if (type_ind == (size_t)ESetTypes::eFloat)
+         {
+            float val{};
+            ok = reader.Get(val);
+            prop.number = val;
+         }
+         else if (type_ind == (size_t)ESetTypes::eInt)
+         {
+            int val{};
+            ok = reader.Get(val);
+            prop.number = val;
+         }
+         else if (type_ind == (size_t)ESetTypes::eString)
+         {
+            ok = reader.Get(prop.text);
+         }
+
+         if (!ok)
+            return false;
+
+         doc_.properties.push_back(prop);
+      }
+
+      doc_.arrows.push_back(arrow);
+   }
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+static bool read_v2(const unsigned char* pData_, size_t size_, dat::Document& doc_)
+{
+   if (size_ < header_size)
+      return false;
+
+   const unsigned char* pos = pData_ + sizeof(magic);
+
+   if (get_u32(pos) != dat::version)
+      return false;
+
+   uint32_t string_count   = get_u32(pos +  4);
+   uint32_t node_count     = get_u32(pos +  8);
+   uint32_t arrow_count    = get_u32(pos + 12);
+   uint32_t property_count = get_u32(pos + 16);
+   uint64_t string_bytes   = get_u64(pos + 20);
+
+   uint64_t expected = header_size +
+         uint64_t(string_count + 1ull) * sizeof(uint32_t) + string_bytes +
+         uint64_t(node_count) * sizeof(uint32_t) +
+         uint64_t(arrow_count) * arrow_size +
+         uint64_t(property_count) * property_size;
+
+   if (expected != size_)
+      return false;
+
+   const unsigned char* offsets  = pData_ + header_size;
+   const char*          blob     = (const char*)(offsets + (string_count + 1ull) * sizeof(uint32_t));
+
+   std::vector<std::string_view> strings(string_count);
+   for (uint32_t i = 0; i < string_count; ++i)
+   {
+      uint32_t begin = get_u32(offsets + i * sizeof(uint32_t));
+      uint32_t end   = get_u32(offsets + (i + 1) * sizeof(uint32_t));
+
+      if (begin > end || end > string_bytes)
+         return false;
+
+      strings[i] = std::string_view(blob + begin, end - begin);
+   }
+
+   pos = (const unsigned char*)blob + string_bytes;
+
+   auto string_at = [&](uint32_t index_, std::string_view& str_)
+   {
+      if (index_ >= string_count)
+         return false;
+
+      str_ = strings[index_];
+      return true;
+   };
+
+   doc_.nodes.resize(node_count);
+   for (uint32_t i = 0; i < node_count; ++i, pos += sizeof(uint32_t))
+   {
+      if (!string_at(get_u32(pos), doc_.nodes[i]))
+         return false;
+   }
+
+   doc_.arrows.resize(arrow_count);
+   for (uint32_t i = 0; i < arrow_count; ++i, pos += arrow_size)
+   {
+      dat::Arrow& arrow = doc_.arrows[i];
+
+      if (!string_at(get_u32(pos), arrow.name) || !string_at(get_u32(pos + 4), arrow.source) || !string_at(get_u32(pos + 8), arrow.target))
+         return false;
+
+      arrow.first_property = get_u32(pos + 12);
+      arrow.property_count = get_u32(pos + 16);
+
+      if (uint64_t(arrow.first_property) + arrow.property_count > property_count)
+         return false;
+   }
+
+   doc_.properties.resize(property_count);
+   for (uint32_t i = 0; i < property_count; ++i, pos += property_size)
+   {
+      dat::Property& prop = doc_.properties[i];
+
+      if (!string_at(get_u32(pos), prop.name))
+         return false;
+
+      uint32_t type_ind = get_u32(pos + 4);
+      uint64_t payload  = get_u64(pos + 8);
+
+      prop.type = (ESetTypes)type_ind;
+
+      if (type_ind == (uint32_t)ESetTypes::eDouble)
+      {
+         double val{};
+         std::memcpy(&val, &payload, sizeof(val));
+         prop.number = val;
+      }
+      else if (type_ind == (uint32_t)ESetTypes::eFloat)
+      {
+         uint32_t bits = uint32_t(payload);
+         float val{};
+         std::memcpy(&val, &bits, sizeof(val));
+         prop.number = val;
+      }
+      else if (type_ind == (uint32_t)ESetTypes::eInt)
+      {
+         prop.number = int32_t(uint32_t(payload));
+      }
+      else if (type_ind == (uint32_t)ESetTypes::eString)
+      {
+         if (payload > UINT32_MAX || !string_at(uint32_t(payload), prop.text))
+            return false;
+      }
+      else
+         return false;
+   }
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+std::string_view dat::Document::Own(std::string str_)
+{
+   return storage.emplace_back(std::move(str_));
+}
+
+//----------------------------------------------------------------------
+TSetValue dat::ToValue(const Property& prop_)
+{
+   switch (prop_.type)
+   {
+   case ESetTypes::eDouble : return TSetValue(prop_.number);
+   case ESetTypes::eFloat  : return TSetValue(float(prop_.number));
+   case ESetTypes::eInt    : return TSetValue(int(prop_.number));
+   case ESetTypes::eString : return TSetValue(std::string(prop_.text));
+   }
+
+   return TSetValue();
+}
+
+//----------------------------------------------------------------------
+dat::Property dat::FromValue(const Function& fn_, Document& doc_)
+{
+   Property prop;
+   prop.name = doc_.Own(fn_.first);
+   prop.type = (ESetTypes)fn_.second.index();
+
+   if (const double* pVal = std::get_if<double>(&fn_.second))
+      prop.number = *pVal;
+   else if (const float* pVal = std::get_if<float>(&fn_.second))
+      prop.number = *pVal;
+   else if (const int* pVal = std::get_if<int>(&fn_.second))
+      prop.number = *pVal;
+   else if (const std::string* pVal = std::get_if<std::string>(&fn_.second))
+      prop.text = doc_.Own(*pVal);
+
+   return prop;
+}
+
+//----------------------------------------------------------------------
+bool dat::Read(const char* pData_, size_t size_, Document& doc_)
+{
+   doc_.nodes      .clear();
+   doc_.arrows     .clear();
+   doc_.properties .clear();
+
+   bool ok = size_ >= sizeof(magic) && std::memcmp(pData_, magic, sizeof(magic)) == 0 ?
+      read_v2((const unsigned char*)pData_, size_, doc_) :
+      read_v1(pData_, size_, doc_);
+
+   if (!ok)
+   {
+      doc_.nodes      .clear();
+      doc_.arrows     .clear();
+      doc_.properties .clear();
+   }
+
+   return ok;
+}
+
+//----------------------------------------------------------------------
+bool dat::Write(const Document& doc_, std::string& out_)
+{
+   out_.clear();
+
+   if (doc_.nodes.size() > UINT32_MAX || doc_.arrows.size() > UINT32_MAX || doc_.properties.size() > UINT32_MAX)
+      return false;
+
+   std::unordered_map<std::string_view, uint32_t> indices;
+   std::vector<std::string_view> strings;
+   uint64_t string_bytes{};
+
+   auto index_of = [&](std::string_view str_)
+   {
+      auto [it, inserted] = indices.emplace(str_, (uint32_t)strings.size());
+      if (inserted)
+      {
+         strings.push_back(str_);
+         string_bytes += str_.size();
+      }
+
+      return it->second;
+   };
+
+   std::vector<uint32_t> node_ids;
+   node_ids.reserve(doc_.nodes.size());
+   for (std::string_view name : doc_.nodes)
+      node_ids.push_back(index_of(name));
+
+   std::vector<uint32_t> arrow_ids;
+   arrow_ids.reserve(doc_.arrows.size() * 3);
+   for (const Arrow& arrow : doc_.arrows)
+   {
+      arrow_ids.push_back(index_of(arrow.name));
+      arrow_ids.push_back(index_of(arrow.source));
+      arrow_ids.push_back(index_of(arrow.target));
+   }
+
+   std::vector<uint32_t> prop_ids;
+   prop_ids.reserve(doc_.properties.size() * 2);
+   for (const Property& prop : doc_.properties)
+   {
+      prop_ids.push_back(index_of(prop.name));
+      prop_ids.push_back(prop.type == ESetTypes::eString ? index_of(prop.text) : 0);
+   }
+
+   // Offsets into the blob are u32, the end offset included
+   if (strings.size() > UINT32_MAX || string_bytes > UINT32_MAX)
+      return false;
+   out_.reserve(header_size +
+                (strings.size() + 1) * sizeof(uint32_t) + string_bytes +
+                doc_.nodes.size() * sizeof(uint32_t) +
+                doc_.arrows.size() * arrow_size +
+                doc_.properties.size() * property_size);
+
+   out_.append(magic, sizeof(magic));
+   put_u32(out_, version);
+   put_u32(out_, (uint32_t)strings.size());
+   put_u32(out_, (uint32_t)doc_.nodes.size());
+   put_u32(out_, (uint32_t)doc_.arrows.size());
+   put_u32(out_, (uint32_t)doc_.properties.size());
+   put_u64(out_, string_bytes);
+
+   uint32_t offset{};
+   for (std::string_view str : strings)
+   {
+      put_u32(out_, offset);
+      offset += (uint32_t)str.size();
+   }
+   put_u32(out_, offset);
+
+   for (std::string_view str : strings)
+      out_.append(str.data(), str.size());
+
+   for (uint32_t id : node_ids)
+      put_u32(out_, id);
+
+   for (size_t i = 0; i < doc_.arrows.size(); ++i)
+   {
+      put_u32(out_, arrow_ids[i * 3 + 0]);
+      put_u32(out_, arrow_ids[i * 3 + 1]);
+      put_u32(out_, arrow_ids[i * 3 + 2]);
+      put_u32(out_, doc_.arrows[i].first_property);
+      put_u32(out_, doc_.arrows[i].property_count);
+   }
+
+   for (size_t i = 0; i < doc_.properties.size(); ++i)
+   {
+      const Property& prop = doc_.properties[i];
+
+      put_u32(out_, prop_ids[i * 2]);
+      put_u32(out_, (uint32_t)prop.type);
+
+      uint64_t payload{};
+      if (prop.type == ESetTypes::eDouble)
+      {
+         double val = prop.number;
+         std::memcpy(&payload, &val, sizeof(val));
+      }
+      else if (prop.type == ESetTypes::eFloat)
+      {
+         float val = float(prop.number);
+         uint32_t bits{};
+         std::memcpy(&bits, &val, sizeof(val));
+         payload = bits;
+      }
+      else if (prop.type == ESetTypes::eInt)
+      {
+         payload = uint32_t(int32_t(prop.number));
+      }
+      else if (prop.type == ESetTypes::eString)
+      {
+         payload = prop_ids[i * 2 + 1];
+      }
+
+      put_u64(out_, payload);
+   }
+
+   return true;
+}
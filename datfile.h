@@ -0,0 +1,81 @@
+#ifndef DATFILE_H
+#define DATFILE_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "node.h"
+
+// Binary .dat serialization.
+//
+// v1 is the legacy layout: native-endian size_t counts and length-prefixed
+// strings, read field by field.
+//
+// v2 layout, all integers little-endian:
+//
+//    header      char[4] "CATD", u32 version, u32 string_count, u32 node_count,
+//                u32 arrow_count, u32 property_count, u64 string_bytes
+//    strings     u32 offsets[string_count + 1], char blob[string_bytes]
+//    nodes       u32 name[node_count]
+//    arrows      { u32 name, source, target, first_property, property_count }[arrow_count]
+//    properties  { u32 name, u32 type, u64 payload }[property_count]
+//
+// Strings are deduplicated through the string table. Property payload holds the
+// bit pattern of a double or float in its low bits, an int as two's complement
+// in the low 32 bits with the upper half zero, or a string table index.
+// String offsets and counts are u32, so the blob of distinct strings and every
+// table are limited to 4 GiB or 2^32 entries.
+namespace dat
+{
+   constexpr uint32_t version = 2;
+
+   struct Property
+   {
+      std::string_view  name;
+      cat::ESetTypes    type     {cat::ESetTypes::eInt};
+      double            number   {};
+      std::string_view  text;
+   };
+
+   struct Arrow
+   {
+      std::string_view  name;
+      std::string_view  source;
+      std::string_view  target;
+      uint32_t          first_property {};
+      uint32_t          property_count {};
+   };
+
+   // Flat view of a category. Names and string values are views either into the
+   // buffer passed to Read or into the document's own storage.
+   struct Document
+   {
+      Document() = default;
+      Document(Document&&) = default;
+      Document& operator=(Document&&) = default;
+      Document(const Document&) = delete;
+      Document& operator=(const Document&) = delete;
+
+      std::string_view Own(std::string str_);
+
+      std::vector<std::string_view> nodes;
+      std::vector<Arrow>            arrows;
+      std::vector<Property>         properties;
+      std::deque<std::string>       storage;
+   };
+
+   cat::TSetValue ToValue(const Property& prop_);
+   Property FromValue(const cat::Function& fn_, Document& doc_);
+
+   // Parses v1 or v2 data, the buffer must outlive the document
+   bool Read(const char* pData_, size_t size_, Document& doc_);
+
+   // Serializes the document in v2 layout, fails and leaves out_ empty when
+   // the document exceeds the limits of the layout
+   bool Write(const Document& doc_, std::string& out_);
+}
+
+#endif
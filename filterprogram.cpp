@@ -0,0 +1,347 @@
+#include "filterprogram.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace cat;
+
+// Longest supported chain of nested operands
+static const size_t  max_depth   = 256;
+
+// Deepest supported parentheses, the parser recurses once per level
+static const size_t  max_nesting = 256;
+
+//----------------------------------------------------------------------
+static double to_double(const TSetValue& value_)
+{
+   return std::visit([](const auto& elem_) -> double
+   {
+      if constexpr (std::is_same_v<std::decay_t<decltype(elem_)>, std::string>)
+         return 0.0;
+      else
+         return double(elem_);
+   }, value_);
+}
+
+//----------------------------------------------------------------------
+class FilterCompiler
+{
+public:
+   FilterCompiler(const std::string& text_, FilterProgram& program_) :
+         m_text      (text_)
+      ,  m_program   (program_)
+   {
+   }
+
+   void Run()
+   {
+      next();
+      parseOr();
+
+      if (m_kind != EKind::eEnd)
+         fail();
+   }
+
+private:
+   using EOp = FilterProgram::EOp;
+
+   enum class EKind
+   {
+         eName
+      ,  eNumber
+      ,  eString
+      ,  eCompare
+      ,  eAnd
+      ,  eOr
+      ,  eOpen
+      ,  eClose
+      ,  eEnd
+   };
+
+   [[noreturn]] void fail() const
+   {
+      throw std::invalid_argument("Incorrect expression");
+   }
+
+   void next()
+   {
+      while (m_pos < m_text.size() && std::isspace((unsigned char)m_text[m_pos]))
+         ++m_pos;
+
+      m_token.clear();
+
+      if (m_pos == m_text.size())
+      {
+         m_kind = EKind::eEnd;
+         return;
+      }
+
+      char c    = m_text[m_pos];
+      char next = m_pos + 1 < m_text.size() ? m_text[m_pos + 1] : '\0';
+
+      if (c == '(' || c == ')')
+      {
+         m_kind = c == '(' ? EKind::eOpen : EKind::eClose;
+         ++m_pos;
+      }
+      else if (c == '&' || c == '|')
+      {
+         m_kind = c == '&' ? EKind::eAnd : EKind::eOr;
+         m_pos += next == c ? 2 : 1;
+      }
+      else if (c == '=' || c == '!' || c == '<' || c == '>')
+      {
+         m_kind = EKind::eCompare;
+
+         if (c == '!' && next != '=')
+            fail();
+
+         bool equal = next == '=';
+
+         if       (c == '=')  m_op = EOp::eEQ;
+         else if  (c == '!')  m_op = EOp::eNEQ;
+         else if  (c == '<')  m_op = equal ? EOp::eLE : EOp::eLT;
+         else                 m_op = equal ? EOp::eGE : EOp::eGT;
+
+         m_pos += equal ? 2 : 1;
+      }
+      else if (c == '"' || c == '\'')
+      {
+         m_kind = EKind::eString;
+
+         for (++m_pos; m_pos < m_text.size() && m_text[m_pos] != c; ++m_pos)
+         {
+            if (m_text[m_pos] == '\\' && m_pos + 1 < m_text.size())
+               ++m_pos;
+
+            m_token.push_back(m_text[m_pos]);
+         }
+
+         if (m_pos == m_text.size())
+            fail();
+
+         ++m_pos;
+      }
+      else if (std::isdigit((unsigned char)c) || ((c == '-' || c == '+' || c == '.') && (std::isdigit((unsigned char)next) || next == '.')))
+      {
+         m_kind = EKind::eNumber;
+
+         const char* begin = m_text.c_str() + m_pos;
+         char* end {};
+
+         double number = std::strtod(begin, &end);
+         if (end == begin)
+            fail();
+
+         std::string text(begin, (const char*)end);
+         m_pos += text.size();
+
+         if (m_pos < m_text.size() && (m_text[m_pos] == 'f' || m_text[m_pos] == 'F'))
+         {
+            m_value = float(number);
+            ++m_pos;
+         }
+         else if (text.find_first_of(".eE") == std::string::npos && number >= INT32_MIN && number <= INT32_MAX)
+            m_value = int(number);
+         else
+            m_value = number;
+      }
+      else if (std::isalpha((unsigned char)c) || c == '_')
+      {
+         while (m_pos < m_text.size() && (std::isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_' || m_text[m_pos] == '.'))
+            m_token.push_back(m_text[m_pos++]);
+
+         std::string lower;
+         for (char ch : m_token)
+            lower.push_back((char)std::tolower((unsigned char)ch));
+
+         if       (lower == "and")  m_kind = EKind::eAnd;
+         else if  (lower == "or")   m_kind = EKind::eOr;
+         else                       m_kind = EKind::eName;
+      }
+      else
+         fail();
+   }
+
+   void emit(EOp op_, uint32_t slot_ = 0, uint32_t constant_ = 0)
+   {
+      m_program.m_code.push_back({ op_, slot_, constant_ });
+
+      if (op_ == EOp::eAnd || op_ == EOp::eOr)
+         --m_depth;
+      else if (++m_depth > max_depth)
+         throw std::invalid_argument("Expression is too long");
+
+      m_program.m_depth = std::max(m_program.m_depth, m_depth);
+   }
+
+   void parseOr()
+   {
+      parseAnd();
+
+      while (m_kind == EKind::eOr)
+      {
+         next();
+         parseAnd();
+         emit(EOp::eOr);
+      }
+   }
+
+   void parseAnd()
+   {
+      parseTerm();
+
+      while (m_kind == EKind::eAnd)
+      {
+         next();
+         parseTerm();
+         emit(EOp::eAnd);
+      }
+   }
+
+   void parseTerm()
+   {
+      if (m_kind == EKind::eOpen)
+      {
+         if (++m_nesting > max_nesting)
+            throw std::invalid_argument("Expression is nested too deeply");
+
+         next();
+         parseOr();
+
+         if (m_kind != EKind::eClose)
+            fail();
+
+         --m_nesting;
+
+         next();
+         return;
+      }
+
+      if (m_kind != EKind::eName && m_kind != EKind::eString)
+         fail();
+
+      std::string name = m_token;
+      next();
+
+      if (m_kind != EKind::eCompare)
+         fail();
+
+      EOp op = m_op;
+      next();
+
+      if (m_kind == EKind::eNumber)
+         m_program.m_constants.push_back(m_value);
+      else if (m_kind == EKind::eString || m_kind == EKind::eName)
+         m_program.m_constants.push_back(m_token);
+      else
+         fail();
+
+      next();
+
+      auto [it, inserted] = m_program.m_slotIndex.emplace(name, (int)m_program.m_slots.size());
+      if (inserted)
+         m_program.m_slots.push_back(name);
+
+      emit(op, (uint32_t)it->second, uint32_t(m_program.m_constants.size() - 1));
+   }
+
+   const std::string&   m_text;
+   FilterProgram&       m_program;
+   size_t               m_pos       {};
+   size_t               m_depth     {};
+   size_t               m_nesting   {};
+
+   EKind                m_kind      {EKind::eEnd};
+   std::string          m_token;
+   TSetValue            m_value;
+   EOp                  m_op        {};
+};
+
+//----------------------------------------------------------------------
+FilterProgram FilterProgram::Compile(const std::string& expression_)
+{
+   FilterProgram program;
+
+   FilterCompiler(expression_, program).Run();
+
+   return program;
+}
+
+//----------------------------------------------------------------------
+const std::vector<std::string>& FilterProgram::Slots() const
+{
+   return m_slots;
+}
+
+//----------------------------------------------------------------------
+int FilterProgram::Slot(const std::string& name_) const
+{
+   auto it = m_slotIndex.find(name_);
+
+   return it != m_slotIndex.end() ? it->second : -1;
+}
+
+//----------------------------------------------------------------------
+bool FilterProgram::Eval(const TSetValue* const* values_) const
+{
+   bool stack[max_depth];
+   size_t top{};
+
+   for (const Instruction& instr : m_code)
+   {
+      if (instr.op == EOp::eAnd || instr.op == EOp::eOr)
+      {
+         bool right = stack[--top];
+         bool& left = stack[top - 1];
+
+         left = instr.op == EOp::eAnd ? left && right : left || right;
+         continue;
+      }
+
+      const TSetValue* pValue   = values_[instr.slot];
+      const TSetValue& constant = m_constants[instr.constant];
+
+      bool result {};
+
+      if (pValue)
+      {
+         bool lstring = std::holds_alternative<std::string>(*pValue);
+         bool rstring = std::holds_alternative<std::string>(constant);
+
+         if (lstring == rstring)
+         {
+            int order {};
+
+            if (lstring)
+            {
+               order = std::get<std::string>(*pValue).compare(std::get<std::string>(constant));
+            }
+            else
+            {
+               double left  = to_double(*pValue);
+               double right = to_double(constant);
+
+               order = left < right ? -1 : (left > right ? 1 : 0);
+            }
+
+            switch (instr.op)
+            {
+            case EOp::eEQ  : result = order == 0;  break;
+            case EOp::eNEQ : result = order != 0;  break;
+            case EOp::eLT  : result = order <  0;  break;
+            case EOp::eGT  : result = order >  0;  break;
+            case EOp::eLE  : result = order <= 0;  break;
+            case EOp::eGE  : result = order >= 0;  break;
+            default        :                       break;
+            }
+         }
+      }
+
+      stack[top++] = result;
+   }
+
+   return top == 1 && stack[0];
+}
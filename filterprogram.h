@@ -0,0 +1,65 @@
+#ifndef FILTERPROGRAM_H
+#define FILTERPROGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "node.h"
+
+// Filter expression compiled once into a flat postfix program. Property names
+// are resolved to slots, evaluation reads one value per slot.
+//
+//    expr     := and { ( '|' | '||' | or ) and }
+//    and      := term { ( '&' | '&&' | and ) term }
+//    term     := '(' expr ')' | name op value
+//    op       := '==' | '=' | '!=' | '<' | '>' | '<=' | '>='
+//    value    := number | "string" | 'string' | word
+//
+// Numbers compare numerically whatever their stored type, strings
+// lexicographically. A missing property or a number/string mismatch fails.
+class FilterProgram
+{
+public:
+   // Throws std::invalid_argument on malformed expressions
+   static FilterProgram Compile(const std::string& expression_);
+
+   const std::vector<std::string>& Slots() const;
+
+   // Slot of the property or -1 when the program does not reference it
+   int Slot(const std::string& name_) const;
+
+   // values_[slot] points to the property value or is null when missing
+   bool Eval(const cat::TSetValue* const* values_) const;
+
+private:
+   enum class EOp : uint8_t
+   {
+         eEQ
+      ,  eNEQ
+      ,  eLT
+      ,  eGT
+      ,  eLE
+      ,  eGE
+      ,  eAnd
+      ,  eOr
+   };
+
+   struct Instruction
+   {
+      EOp      op       {};
+      uint32_t slot     {};
+      uint32_t constant {};
+   };
+
+   friend class FilterCompiler;
+
+   std::vector<Instruction>               m_code;
+   std::vector<cat::TSetValue>            m_constants;
+   std::vector<std::string>               m_slots;
+   std::unordered_map<std::string, int>   m_slotIndex;
+   size_t                                 m_depth {};
+};
+
+#endif
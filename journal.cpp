@@ -0,0 +1,309 @@
+#include "journal.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+
+using namespace cat;
+
+static const char    magic[4]       = { 'C', 'A', 'T', 'J' };
+static const quint32 version        = 1;
+
+static const int     header_size    = sizeof(magic) + 4 + 8 + 8;
+static const int     frame_size     = 4 + 2;
+
+//----------------------------------------------------------------------
+static QByteArray header(const QString& base_)
+{
+   QFileInfo info(base_);
+
+   QByteArray data;
+   QDataStream stream(&data, QIODevice::WriteOnly);
+
+   stream.writeRawData(magic, sizeof(magic));
+   stream << version << qint64(info.size()) << qint64(info.lastModified().toMSecsSinceEpoch());
+
+   return data;
+}
+
+//----------------------------------------------------------------------
+static QByteArray encode(const Journal::Record& record_)
+{
+   QByteArray payload;
+
+   {
+      QDataStream stream(&payload, QIODevice::WriteOnly);
+
+      stream << quint8(record_.type) << quint32(record_.names.size());
+
+      for (const std::string& name : record_.names)
+         stream << QByteArray::fromStdString(name);
+
+      stream << record_.pos << quint32(record_.properties.size());
+
+      for (const auto& [name, value] : record_.properties)
+      {
+         stream << QByteArray::fromStdString(name) << quint8(value.index());
+
+         if (const double* pVal = std::get_if<double>(&value))
+            stream << *pVal;
+         else if (const float* pVal = std::get_if<float>(&value))
+            stream << *pVal;
+         else if (const int* pVal = std::get_if<int>(&value))
+            stream << qint32(*pVal);
+         else if (const std::string* pVal = std::get_if<std::string>(&value))
+            stream << QByteArray::fromStdString(*pVal);
+      }
+   }
+
+   QByteArray data;
+   QDataStream stream(&data, QIODevice::WriteOnly);
+
+   stream << quint32(payload.size()) << qChecksum(payload.constData(), (uint)payload.size());
+   stream.writeRawData(payload.constData(), payload.size());
+
+   return data;
+}
+
+//----------------------------------------------------------------------
+static bool decode(const QByteArray& payload_, Journal::Record& record_)
+{
+   QDataStream stream(payload_);
+
+   quint8   type  {};
+   quint32  count {};
+
+   stream >> type >> count;
+
+   if (type > (quint8)Journal::ERecord::eRemoveProperty)
+      return false;
+
+   record_.type = (Journal::ERecord)type;
+
+   for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+   {
+      QByteArray name;
+      stream >> name;
+
+      record_.names.push_back(name.toStdString());
+   }
+
+   stream >> record_.pos >> count;
+
+   for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+   {
+      QByteArray  name;
+      quint8      index {};
+
+      stream >> name >> index;
+
+      TSetValue value;
+
+      switch ((ESetTypes)index)
+      {
+      case ESetTypes::eDouble:   { double     val {}; stream >> val; value = val;                   break; }
+      case ESetTypes::eFloat:    { float      val {}; stream >> val; value = val;                   break; }
+      case ESetTypes::eInt:      { qint32     val {}; stream >> val; value = int(val);              break; }
+      case ESetTypes::eString:   { QByteArray val;    stream >> val; value = val.toStdString();     break; }
+      default:                   return false;
+      }
+
+      record_.properties.emplace_back(name.toStdString(), value);
+   }
+
+   return stream.status() == QDataStream::Ok;
+}
+
+//----------------------------------------------------------------------
+// Length of the part of the journal that applies to base_, its records
+// are decoded into pRecords_ when given
+static qint64 parse(const QByteArray& data_, const QString& base_, std::vector<Journal::Record>* pRecords_)
+{
+   if (data_.size() < header_size || data_.left(header_size) != header(base_))
+      return 0;
+
+   qint64 pos = header_size;
+
+   while (pos + frame_size <= data_.size())
+   {
+      quint32 size      {};
+      quint16 checksum  {};
+
+      QDataStream stream(QByteArray::fromRawData(data_.constData() + pos, frame_size));
+      stream >> size >> checksum;
+
+      if (pos + frame_size + (qint64)size > data_.size())
+         break;
+
+      const char* pPayload = data_.constData() + pos + frame_size;
+
+      if (qChecksum(pPayload, size) != checksum)
+         break;
+
+      if (pRecords_)
+      {
+         Journal::Record record;
+         if (!decode(QByteArray::fromRawData(pPayload, (int)size), record))
+            break;
+
+         pRecords_->push_back(std::move(record));
+      }
+
+      pos += frame_size + size;
+   }
+
+   return pos;
+}
+
+//----------------------------------------------------------------------
+QString Journal::PathFor(const QString& base_)
+{
+   return base_ + ".journal";
+}
+
+//----------------------------------------------------------------------
+std::vector<Journal::Record> Journal::Read(const QString& base_)
+{
+   std::vector<Record> records;
+
+   QFile file(PathFor(base_));
+   if (file.open(QIODevice::ReadOnly))
+      parse(file.readAll(), base_, &records);
+
+   return records;
+}
+
+//----------------------------------------------------------------------
+void Journal::Open(const QString& base_)
+{
+   Close();
+
+   m_base = base_;
+}
+
+//----------------------------------------------------------------------
+void Journal::Close()
+{
+   m_file.close();
+   m_base.clear();
+
+   m_size   = 0;
+   m_marked = false;
+   m_sinceMark.clear();
+}
+
+//----------------------------------------------------------------------
+bool Journal::IsOpen() const
+{
+   return !m_base.isEmpty();
+}
+
+//----------------------------------------------------------------------
+QString Journal::Base() const
+{
+   return m_base;
+}
+
+//----------------------------------------------------------------------
+void Journal::Append(const Record& record_)
+{
+   if (m_base.isEmpty())
+      return;
+
+   if (!m_file.isOpen())
+   {
+      // Continuing the journal the base was loaded with, less a torn tail
+      QFile existing(PathFor(m_base));
+
+      qint64 valid = existing.open(QIODevice::ReadOnly) ? parse(existing.readAll(), m_base, nullptr) : 0;
+
+      existing.close();
+
+      if (valid > 0)
+      {
+         m_file.setFileName(PathFor(m_base));
+
+         if (!m_file.open(QIODevice::ReadWrite) || !m_file.resize(valid) || !m_file.seek(valid))
+            return;
+
+         m_size = valid - header_size;
+      }
+      else if (!create(QByteArray()))
+      {
+         return;
+      }
+   }
+
+   QByteArray data = encode(record_);
+
+   // Flushed per record so that an edit survives the editor crashing
+   m_file.write(data);
+   m_file.flush();
+
+   m_size += data.size();
+
+   if (m_marked)
+      m_sinceMark += data;
+}
+
+//----------------------------------------------------------------------
+qint64 Journal::Size() const
+{
+   return m_size;
+}
+
+//----------------------------------------------------------------------
+void Journal::Mark()
+{
+   m_marked = true;
+   m_sinceMark.clear();
+}
+
+//----------------------------------------------------------------------
+bool Journal::Rebase(const QString& base_)
+{
+   QByteArray records = m_marked ? m_sinceMark : QByteArray();
+
+   m_file.close();
+
+   m_base   = base_;
+   m_size   = 0;
+   m_marked = false;
+   m_sinceMark.clear();
+
+   if (records.isEmpty())
+   {
+      // Created with the next edit, a journal of the previous version goes
+      QFile::remove(PathFor(m_base));
+      return true;
+   }
+
+   return create(records);
+}
+
+//----------------------------------------------------------------------
+bool Journal::create(const QByteArray& records_)
+{
+   m_file.close();
+
+   QSaveFile file(PathFor(m_base));
+
+   if (!file.open(QIODevice::WriteOnly))
+      return false;
+
+   file.write(header(m_base));
+   file.write(records_);
+
+   if (!file.commit())
+      return false;
+
+   m_file.setFileName(PathFor(m_base));
+
+   if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+      return false;
+
+   m_size = records_.size();
+
+   return true;
+}
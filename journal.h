@@ -0,0 +1,81 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QPointF>
+
+#include "node.h"
+
+// Append-only log of the model edits made since a .dat file was written,
+// kept next to it as <file>.journal. Loading the file replays the journal
+// on top of it, writing the file starts a new journal.
+//
+//    header   char[4] "CATJ", u32 version, i64 base size, i64 base mtime
+//    record   u32 size, u16 checksum, payload[size]
+//
+// The header ties the journal to the version of the base file it was
+// started for, a journal left behind by an older version is ignored. A
+// record torn by a crash fails its checksum and ends the replay.
+class Journal
+{
+public:
+   enum class ERecord : quint8
+   {
+         eAddNode
+      ,  eEraseNode
+      ,  eAddArrow
+      ,  eEraseArrow
+      ,  eCloneNode
+      ,  eSetProperties
+      ,  eRemoveProperty
+   };
+
+   // Names are the node, arrow or property names of the edit, in the
+   // order of the Scene call that made it
+   struct Record
+   {
+      ERecord                    type  {};
+      std::vector<std::string>   names;
+      QPointF                    pos;
+      std::list<cat::Function>   properties;
+   };
+
+   static QString PathFor(const QString& base_);
+
+   // Records of the journal of base_ that apply to its current version
+   static std::vector<Record> Read(const QString& base_);
+
+   // Edits are journaled for base_ from now on, the file is only created
+   // with the first record
+   void Open(const QString& base_);
+   void Close();
+   bool IsOpen() const;
+   QString Base() const;
+
+   void Append(const Record& record_);
+
+   // Bytes appended since the base was written
+   qint64 Size() const;
+
+   // Marks the state of the model a snapshot is taken of. Once the snapshot
+   // is written to base_, Rebase starts its journal with the records
+   // appended after the mark.
+   void Mark();
+   bool Rebase(const QString& base_);
+
+private:
+   bool create(const QByteArray& records_);
+
+   QString     m_base;
+   QFile       m_file;
+   qint64      m_size      {};
+
+   bool        m_marked    {};
+   QByteArray  m_sinceMark;
+};
+
+#endif
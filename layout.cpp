@@ -0,0 +1,379 @@
+#include "layout.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "parallel.h"
+
+static const double  pi             = 3.14159265358979323846;
+
+// Barnes-Hut opening angle, cells seen under a smaller angle are treated as one body
+static const double  theta          = 1.0;
+static const int     max_depth      = 48;
+
+//----------------------------------------------------------------------
+static bool is_leaf(const int32_t (&child_)[4])
+{
+   return child_[0] < 0 && child_[1] < 0 && child_[2] < 0 && child_[3] < 0;
+}
+
+//----------------------------------------------------------------------
+ForceLayout::ForceLayout(std::vector<Point> positions_, std::vector<bool> pinned_, const std::vector<Edge>& edges_, double extent_, bool scatter_) :
+      m_positions (std::move(positions_))
+   ,  m_pinned    (std::move(pinned_))
+   ,  m_extent    (extent_)
+{
+   const size_t count = m_positions.size();
+
+   m_pinned .resize(count, false);
+   m_disp   .resize(count);
+
+   m_k            = std::sqrt(m_extent * m_extent / std::max<size_t>(count, 1));
+   m_temperature  = m_extent * 0.1;
+   m_iterations   = std::clamp(int(5e6 / std::max<size_t>(count, 1)), 30, 300);
+
+   // Adjacency in both directions, stored compressed so that each node sums
+   // its own attraction without synchronization
+   m_offsets.assign(count + 1, 0);
+
+   for (const Edge& edge : edges_)
+   {
+      if (edge.first == edge.second || edge.first >= count || edge.second >= count)
+         continue;
+
+      ++m_offsets[edge.first  + 1];
+      ++m_offsets[edge.second + 1];
+   }
+
+   for (size_t i = 1; i <= count; ++i)
+      m_offsets[i] += m_offsets[i - 1];
+
+   m_adjacent.resize(m_offsets.back());
+
+   std::vector<uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+
+   for (const Edge& edge : edges_)
+   {
+      if (edge.first == edge.second || edge.first >= count || edge.second >= count)
+         continue;
+
+      m_adjacent[fill[edge.first ]++] = edge.second;
+      m_adjacent[fill[edge.second]++] = edge.first;
+   }
+
+   if (scatter_)
+   {
+      const double golden = pi * (3.0 - std::sqrt(5.0));
+
+      for (size_t i = 0; i < count; ++i)
+      {
+         if (m_pinned[i])
+            continue;
+
+         double radius = m_extent * 0.45 * std::sqrt((i + 0.5) / count);
+         double angle  = i * golden;
+
+         m_positions[i] = { m_extent * 0.5 + radius * std::cos(angle), m_extent * 0.5 + radius * std::sin(angle) };
+      }
+   }
+}
+
+//----------------------------------------------------------------------
+void ForceLayout::Step()
+{
+   if (Done())
+      return;
+
+   buildTree();
+
+   parallel_for(m_positions.size(), [this](size_t begin_, size_t end_)
+   {
+      for (size_t i = begin_; i < end_; ++i)
+      {
+         if (m_pinned[i])
+            continue;
+
+         Point rep = repulsion ((uint32_t)i);
+         Point att = attraction((uint32_t)i);
+
+         m_disp[i] = { rep.x + att.x, rep.y + att.y };
+      }
+   });
+
+   parallel_for(m_positions.size(), [this](size_t begin_, size_t end_)
+   {
+      for (size_t i = begin_; i < end_; ++i)
+      {
+         if (m_pinned[i])
+            continue;
+
+         const Point& disp = m_disp[i];
+
+         double len = std::hypot(disp.x, disp.y);
+         if (len <= 0.0)
+            continue;
+
+         double scale = std::min(len, m_temperature) / len;
+
+         Point& pos = m_positions[i];
+         pos.x = std::clamp(pos.x + disp.x * scale, 0.0, m_extent);
+         pos.y = std::clamp(pos.y + disp.y * scale, 0.0, m_extent);
+      }
+   });
+
+   ++m_iteration;
+
+   // Linear cooling
+   m_temperature = m_extent * 0.1 * std::max(0.01, 1.0 - double(m_iteration) / m_iterations);
+}
+
+//----------------------------------------------------------------------
+bool ForceLayout::Done() const
+{
+   return m_positions.empty() || m_iteration >= m_iterations;
+}
+
+//----------------------------------------------------------------------
+const std::vector<ForceLayout::Point>& ForceLayout::Positions() const
+{
+   return m_positions;
+}
+
+//----------------------------------------------------------------------
+const std::vector<bool>& ForceLayout::Pinned() const
+{
+   return m_pinned;
+}
+
+//----------------------------------------------------------------------
+void ForceLayout::buildTree()
+{
+   m_cells.clear();
+
+   double min_x = m_positions.front().x, max_x = min_x;
+   double min_y = m_positions.front().y, max_y = min_y;
+
+   for (const Point& pos : m_positions)
+   {
+      min_x = std::min(min_x, pos.x);
+      max_x = std::max(max_x, pos.x);
+      min_y = std::min(min_y, pos.y);
+      max_y = std::max(max_y, pos.y);
+   }
+
+   Cell root;
+   root.cx   = (min_x + max_x) * 0.5;
+   root.cy   = (min_y + max_y) * 0.5;
+   root.half = std::max(max_x - min_x, max_y - min_y) * 0.5 + 1.0;
+
+   m_cells.reserve(m_positions.size() * 2);
+   m_cells.push_back(root);
+
+   for (uint32_t i = 0; i < (uint32_t)m_positions.size(); ++i)
+      insert(i);
+}
+
+//----------------------------------------------------------------------
+void ForceLayout::insert(uint32_t index_)
+{
+   const Point& pos = m_positions[index_];
+
+   auto quadrant = [this](int32_t cell_, const Point& pos_)
+   {
+      const Cell& cell = m_cells[cell_];
+      return (pos_.x >= cell.cx ? 1 : 0) | (pos_.y >= cell.cy ? 2 : 0);
+   };
+
+   auto child = [this](int32_t cell_, int quadrant_)
+   {
+      if (m_cells[cell_].child[quadrant_] < 0)
+      {
+         const Cell& parent = m_cells[cell_];
+
+         Cell cell;
+         cell.half = parent.half * 0.5;
+         cell.cx   = parent.cx + (quadrant_ & 1 ? cell.half : -cell.half);
+         cell.cy   = parent.cy + (quadrant_ & 2 ? cell.half : -cell.half);
+
+         m_cells.push_back(cell);
+         m_cells[cell_].child[quadrant_] = int32_t(m_cells.size() - 1);
+      }
+
+      return m_cells[cell_].child[quadrant_];
+   };
+
+   int32_t cell = 0;
+
+   for (int depth = 0; ; ++depth)
+   {
+      bool empty  = m_cells[cell].mass == 0.0;
+      bool leaf   = is_leaf(m_cells[cell].child);
+
+      m_cells[cell].mass += 1.0;
+      m_cells[cell].sx   += pos.x;
+      m_cells[cell].sy   += pos.y;
+
+      if (empty)
+      {
+         m_cells[cell].point = (int32_t)index_;
+         return;
+      }
+
+      if (leaf)
+      {
+         // Coincident points are aggregated in the deepest leaf
+         if (depth >= max_depth)
+            return;
+
+         int32_t old = m_cells[cell].point;
+         m_cells[cell].point = -1;
+
+         const Point& old_pos = m_positions[old];
+
+         int32_t moved = child(cell, quadrant(cell, old_pos));
+         m_cells[moved].mass  = 1.0;
+         m_cells[moved].sx    = old_pos.x;
+         m_cells[moved].sy    = old_pos.y;
+         m_cells[moved].point = old;
+      }
+
+      cell = child(cell, quadrant(cell, pos));
+   }
+}
+
+//----------------------------------------------------------------------
+ForceLayout::Point ForceLayout::repulsion(uint32_t index_) const
+{
+   const Point& pos = m_positions[index_];
+   const double k2  = m_k * m_k;
+
+   Point force;
+
+   std::array<int32_t, 4 * max_depth + 8> stack;
+   size_t top = 0;
+   stack[top++] = 0;
+
+   while (top > 0)
+   {
+      const Cell& cell = m_cells[stack[--top]];
+
+      double mass = cell.mass;
+      double sx   = cell.sx;
+      double sy   = cell.sy;
+
+      bool leaf = is_leaf(cell.child);
+
+      if (leaf && cell.point == (int32_t)index_)
+      {
+         mass  -= 1.0;
+         sx    -= pos.x;
+         sy    -= pos.y;
+      }
+
+      if (mass <= 0.0)
+         continue;
+
+      double dx = pos.x - sx / mass;
+      double dy = pos.y - sy / mass;
+      double d2 = dx * dx + dy * dy;
+
+      double size = cell.half * 2.0;
+
+      if (leaf || size * size < theta * theta * d2)
+      {
+         // Separating coincident bodies in a direction that differs per node
+         if (d2 < 1e-6)
+         {
+            dx = std::cos(double(index_)) * m_k * 0.01;
+            dy = std::sin(double(index_)) * m_k * 0.01;
+            d2 = dx * dx + dy * dy;
+         }
+
+         double scale = mass * k2 / d2;
+
+         force.x += dx * scale;
+         force.y += dy * scale;
+      }
+      else
+      {
+         for (int32_t child : cell.child)
+         {
+            if (child >= 0)
+               stack[top++] = child;
+         }
+      }
+   }
+
+   return force;
+}
+
+//----------------------------------------------------------------------
+ForceLayout::Point ForceLayout::attraction(uint32_t index_) const
+{
+   const Point& pos = m_positions[index_];
+
+   Point force;
+
+   for (uint32_t i = m_offsets[index_]; i < m_offsets[index_ + 1]; ++i)
+   {
+      const Point& other = m_positions[m_adjacent[i]];
+
+      double dx = other.x - pos.x;
+      double dy = other.y - pos.y;
+      double d  = std::hypot(dx, dy);
+
+      force.x += dx * d / m_k;
+      force.y += dy * d / m_k;
+   }
+
+   return force;
+}
+
+//----------------------------------------------------------------------
+LayoutJob::LayoutJob(ForceLayout&& layout_, QObject* pParent_) :
+      QThread  (pParent_)
+   ,  m_layout (std::move(layout_))
+{
+}
+
+//----------------------------------------------------------------------
+LayoutJob::~LayoutJob()
+{
+   Cancel();
+   wait();
+}
+
+//----------------------------------------------------------------------
+void LayoutJob::Cancel()
+{
+   m_cancel = true;
+}
+
+//----------------------------------------------------------------------
+bool LayoutJob::Snapshot(uint64_t& revision_, std::vector<ForceLayout::Point>& positions_) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   if (revision_ == m_revision)
+      return false;
+
+   positions_  = m_snapshot;
+   revision_   = m_revision;
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+void LayoutJob::run()
+{
+   while (!m_cancel && !m_layout.Done())
+   {
+      m_layout.Step();
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      m_snapshot = m_layout.Positions();
+      ++m_revision;
+   }
+}
@@ -0,0 +1,90 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <QThread>
+
+// Fruchterman-Reingold force-directed layout. Repulsion is approximated with a
+// Barnes-Hut quadtree, force passes are split across all hardware threads.
+class ForceLayout
+{
+public:
+   struct Point
+   {
+      double x {};
+      double y {};
+   };
+
+   using Edge = std::pair<uint32_t, uint32_t>;
+
+   // Pinned nodes take part in the forces but keep their position. Scattered
+   // layouts seed the free nodes on a spiral instead of their current position.
+   ForceLayout(std::vector<Point> positions_, std::vector<bool> pinned_, const std::vector<Edge>& edges_, double extent_, bool scatter_);
+
+   void Step();
+   bool Done() const;
+   const std::vector<Point>& Positions() const;
+   const std::vector<bool>& Pinned() const;
+
+private:
+   struct Cell
+   {
+      double   cx    {};
+      double   cy    {};
+      double   half  {};
+      double   mass  {};
+      double   sx    {};
+      double   sy    {};
+      int32_t  child[4] { -1, -1, -1, -1 };
+      int32_t  point {-1};
+   };
+
+   void buildTree();
+   void insert(uint32_t index_);
+   Point repulsion(uint32_t index_) const;
+   Point attraction(uint32_t index_) const;
+
+   std::vector<Point>      m_positions;
+   std::vector<bool>       m_pinned;
+   std::vector<Point>      m_disp;
+   std::vector<uint32_t>   m_offsets;
+   std::vector<uint32_t>   m_adjacent;
+   std::vector<Cell>       m_cells;
+   double                  m_extent       {};
+   double                  m_k            {};
+   double                  m_temperature  {};
+   int                     m_iteration    {};
+   int                     m_iterations   {};
+};
+
+// Runs a layout in the background and publishes intermediate positions
+class LayoutJob : public QThread
+{
+   Q_OBJECT
+
+public:
+   LayoutJob(ForceLayout&& layout_, QObject* pParent_ = nullptr);
+   ~LayoutJob();
+
+   void Cancel();
+
+   // Copies the latest positions if they changed since the given revision
+   bool Snapshot(uint64_t& revision_, std::vector<ForceLayout::Point>& positions_) const;
+
+protected:
+   void run() override;
+
+private:
+   ForceLayout                      m_layout;
+   std::atomic<bool>                m_cancel    {};
+   mutable std::mutex               m_mutex;
+   std::vector<ForceLayout::Point>  m_snapshot;
+   uint64_t                         m_revision  {};
+};
+
+#endif
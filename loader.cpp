@@ -0,0 +1,257 @@
+#include "loader.h"
+
+#include <QFile>
+
+#include <optional>
+#include <unordered_map>
+
+#include "common.h"
+#include "datfile.h"
+#include "model.h"
+#include "parser.h"
+
+using namespace cat;
+
+//----------------------------------------------------------------------
+static QString toQString(std::string_view str_)
+{
+   return QString::fromUtf8(str_.data(), (int)str_.size());
+}
+
+//----------------------------------------------------------------------
+Loader::Loader(const QString& path_, EFormat format_, QObject* pParent_) :
+      QThread  (pParent_)
+   ,  m_path   (path_)
+   ,  m_format (format_)
+{
+}
+
+//----------------------------------------------------------------------
+Loader::~Loader()
+{
+   Cancel();
+   wait();
+}
+
+//----------------------------------------------------------------------
+bool Loader::Process()
+{
+   bool ok = m_format == EFormat::eBinary ? processBinary() : processText();
+
+   if (!ok || m_cancel)
+   {
+      m_pCategory = nullptr;
+      m_arrows.clear();
+      m_properties.Clear();
+
+      return false;
+   }
+
+   // The set node's identity is a morphism to the set as well
+   if (!m_pCategory->QueryNodes(model::sSet).empty())
+      m_properties.Insert(model::sSet);
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+void Loader::Cancel()
+{
+   m_cancel = true;
+}
+
+//----------------------------------------------------------------------
+std::vector<Loader::NodeRecord> Loader::TakeNodes()
+{
+   return std::move(m_nodes);
+}
+
+//----------------------------------------------------------------------
+std::vector<Loader::ArrowRecord> Loader::TakeArrows()
+{
+   return std::move(m_arrows);
+}
+
+//----------------------------------------------------------------------
+std::shared_ptr<Node> Loader::TakeCategory()
+{
+   return std::move(m_pCategory);
+}
+
+//----------------------------------------------------------------------
+PropertyStore Loader::TakeProperties()
+{
+   return std::move(m_properties);
+}
+
+//----------------------------------------------------------------------
+void Loader::run()
+{
+   emit loaded(Process());
+}
+
+//----------------------------------------------------------------------
+bool Loader::processBinary()
+{
+   QFile file(m_path);
+   if (!file.open(QIODevice::ReadOnly))
+      return false;
+
+   // Names and values are parsed as views into the mapping, copies are only
+   // made by the model and the items that own them
+   const char* pData = (const char*)file.map(0, file.size());
+   if (!pData)
+      return false;
+
+   dat::Document doc;
+   if (!dat::Read(pData, (size_t)file.size(), doc) || m_cancel)
+      return false;
+
+   std::unordered_map<std::string_view, int> indices;
+   indices.reserve(doc.nodes.size());
+
+   m_nodes.reserve(doc.nodes.size());
+
+   for (std::string_view name : doc.nodes)
+   {
+      if (m_cancel)
+         return false;
+
+      if (!indices.emplace(name, (int)m_nodes.size()).second)
+         return false;
+
+      m_nodes.push_back({ toQString(name), QPointF(scene_size * 0.5, scene_size * 0.5) });
+   }
+
+   std::vector<std::pair<int, int>> ends;
+   ends.reserve(doc.arrows.size());
+
+   for (const dat::Arrow& arrow : doc.arrows)
+   {
+      if (m_cancel)
+         return false;
+
+      auto itSource = indices.find(arrow.source);
+      auto itTarget = indices.find(arrow.target);
+
+      if (itSource == indices.end() || itTarget == indices.end())
+         return false;
+
+      ends.emplace_back(itSource->second, itTarget->second);
+
+      std::optional<int> node_x;
+      std::optional<int> node_y;
+
+      for (uint32_t i = 0; i < arrow.property_count; ++i)
+      {
+         const dat::Property& prop = doc.properties[arrow.first_property + i];
+
+         if (prop.name == model::x_token && prop.type == ESetTypes::eInt)
+            node_x = int(prop.number);
+
+         if (prop.name == model::y_token && prop.type == ESetTypes::eInt)
+            node_y = int(prop.number);
+      }
+
+      if (node_x && node_y)
+      {
+         m_nodes[itSource->second].pos    = QPointF(node_x.value(), node_y.value());
+         m_nodes[itSource->second].placed = true;
+      }
+   }
+
+   emit nodesReady();
+
+   m_pCategory = std::make_shared<Node>(Node::NName("Root"), Node::EType::eSCategory);
+
+   for (std::string_view name : doc.nodes)
+   {
+      if (m_cancel)
+         return false;
+
+      if (!m_pCategory->AddNode(Node(std::string(name), Node::EType::eObject)))
+         return false;
+   }
+
+   m_arrows.reserve(doc.arrows.size());
+
+   for (size_t i = 0; i < doc.arrows.size(); ++i)
+   {
+      if (m_cancel)
+         return false;
+
+      const dat::Arrow& record = doc.arrows[i];
+
+      std::list<Function> fns;
+
+      for (uint32_t j = 0; j < record.property_count; ++j)
+      {
+         const dat::Property& prop = doc.properties[record.first_property + j];
+
+         fns.emplace_back(std::string(prop.name), dat::ToValue(prop));
+      }
+
+      Arrow arrow = record.name.empty() ?
+         Arrow(std::string(record.source), std::string(record.target)) :
+         Arrow(std::string(record.source), std::string(record.target), std::string(record.name));
+
+      if (!model::AddArrow(*m_pCategory, arrow, fns))
+      {
+         printf("Error creating arrow: %s \n", arrow.Name().c_str());
+         continue;
+      }
+
+      if (record.target == model::sSet && m_properties.Row(arrow.Source()) == PropertyStore::npos)
+         m_properties.Assign(m_properties.Insert(arrow.Source()), fns);
+
+      m_arrows.push_back({ arrow.Name().c_str(), ends[i].first, ends[i].second });
+   }
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+bool Loader::processText()
+{
+   Parser prs;
+   if (!prs.Parse(m_path.toStdString().c_str()) || m_cancel)
+      return false;
+
+   if (!prs.Data() || prs.Data()->Type() != Node::EType::eSCategory)
+      return false;
+
+   m_pCategory = prs.Data();
+
+   std::unordered_map<std::string, int> indices;
+
+   for (auto& node : m_pCategory->QueryNodes("*"))
+   {
+      if (m_cancel)
+         return false;
+
+      indices.emplace(node.Name(), (int)m_nodes.size());
+
+      m_nodes.push_back({ node.Name().c_str(), QPointF(scene_size * 0.5, scene_size * 0.5) });
+   }
+
+   emit nodesReady();
+
+   for (auto& arrow : m_pCategory->QueryArrows(Arrow("*", "*").AsQuery()))
+   {
+      if (m_cancel)
+         return false;
+
+      auto itSource = indices.find(arrow.Source());
+      auto itTarget = indices.find(arrow.Target());
+
+      if (itSource == indices.end() || itTarget == indices.end())
+         continue;
+
+      m_arrows.push_back({ arrow.Name().c_str(), itSource->second, itTarget->second });
+
+      if (arrow.Target() == model::sSet && m_properties.Row(arrow.Source()) == PropertyStore::npos)
+         m_properties.Assign(m_properties.Insert(arrow.Source()), model::FunctionValues(arrow.Source(), arrow.Target(), *m_pCategory));
+   }
+
+   return true;
+}
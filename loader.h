@@ -0,0 +1,74 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QThread>
+#include <QPointF>
+
+#include "node.h"
+#include "propertystore.h"
+
+// Parses a category file and builds its cat model off the GUI thread.
+// Node records become available first (nodesReady), arrows, the model and
+// its property store once the whole file is processed (loaded).
+class Loader : public QThread
+{
+   Q_OBJECT
+
+public:
+   enum class EFormat
+   {
+         eBinary
+      ,  eText
+   };
+
+   struct NodeRecord
+   {
+      QString  name;
+      QPointF  pos;
+      bool     placed {};
+   };
+
+   struct ArrowRecord
+   {
+      QString  name;
+      int      source {};
+      int      target {};
+   };
+
+   Loader(const QString& path_, EFormat format_, QObject* pParent_ = nullptr);
+   ~Loader();
+
+   bool Process();
+   void Cancel();
+
+   std::vector<NodeRecord>    TakeNodes();
+   std::vector<ArrowRecord>   TakeArrows();
+   std::shared_ptr<cat::Node> TakeCategory();
+   PropertyStore              TakeProperties();
+
+signals:
+   void nodesReady();
+   void loaded(bool ok_);
+
+protected:
+   void run() override;
+
+private:
+   bool processBinary();
+   bool processText();
+
+   QString                    m_path;
+   EFormat                    m_format       {};
+   std::atomic<bool>          m_cancel       {};
+
+   std::vector<NodeRecord>    m_nodes;
+   std::vector<ArrowRecord>   m_arrows;
+   std::shared_ptr<cat::Node> m_pCategory;
+   PropertyStore              m_properties;
+};
+
+#endif
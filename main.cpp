@@ -1,11 +1,17 @@
 #include "mainwindow.h"
+#include "startup.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    startup::Start();
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
+
+    startup::Mark("window shown");
+
     return a.exec();
 }
@@ -7,24 +7,25 @@
 #include <QMouseEvent>
 #include <QDebug>
 #include <QHeaderView>
+#include <QMessageBox>
 #include <QAction>
 #include <QSet>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QStatusBar>
+#include <QTimer>
 
 #include "scene.h"
 #include "common.h"
 #include "ctable.h"
+#include "propertymodel.h"
+#include "recordmodel.h"
+#include "startup.h"
 
 using namespace cat;
 
 static const float table_width_coef = 0.125f;
 
-enum EProperty
-{
-      eName = 0
-   ,  eType
-   ,  eValue
-};
-
 //----------------------------------------------------------------------
 MainWindow::MainWindow(QWidget* pParent_)
    : QMainWindow  (pParent_)
@@ -40,15 +41,58 @@ MainWindow::MainWindow(QWidget* pParent_)
 
    ui->tw->setMinimumWidth(width() * table_width_coef);
 
-   createMenu();
+   // The rest of the initialization waits for the first frame
+   ui->View->viewport()->installEventFilter(this);
 
    connect(m_pScene, SIGNAL(updateStatistics(const QString&)), this, SLOT(updateInfo(const QString&)));
-   connect(m_pScene, SIGNAL(updateNodeData(const std::list<cat::Function>&)), this, SLOT(updateNodeData(const std::list<cat::Function>&)));
+   connect(m_pScene, &Scene::updateNodeData, this, &MainWindow::updateNodeData);
+   connect(m_pScene, &Scene::updateRecords, this, &MainWindow::updateRecords);
+   connect(m_pScene, &Scene::documentClosed, this, &MainWindow::onDocumentClosed);
+
+   m_pRecords = new RecordModel(m_pScene->Properties(), this);
+
+   ui->twTable->setModel(m_pRecords);
+   ui->twTable->setSortingEnabled(true);
+
+   connect(m_pScene, &Scene::loadProgress, this, &MainWindow::onLoadProgress);
+   connect(m_pScene, &Scene::loadFinished, this, &MainWindow::onLoadFinished);
+
+   connect(m_pScene, &Scene::saveProgress, this, &MainWindow::onSaveProgress);
+   connect(m_pScene, &Scene::saveFinished, this, &MainWindow::onSaveFinished);
+
+   connect(m_pScene, &Scene::historyChanged, this, &MainWindow::updateHistory);
+
+   m_pProgress = new QProgressBar(this);
+   m_pCancel   = new QPushButton(tr("Cancel"), this);
+
+   statusBar()->addPermanentWidget(m_pProgress);
+   statusBar()->addPermanentWidget(m_pCancel);
 
-   connect(ui->tw, SIGNAL(cellChanged(int, int)), this, SLOT(onTableItemChanged(int, int)));
+   m_pProgress ->hide();
+   m_pCancel   ->hide();
+
+   m_pSaveProgress = new QProgressBar(this);
+   m_pSaveProgress->setFormat(tr("Saving %p%"));
+
+   statusBar()->addPermanentWidget(m_pSaveProgress);
+
+   m_pSaveProgress->hide();
+
+   connect(m_pCancel, &QPushButton::clicked, this, &MainWindow::onCancelLoad);
+
+   m_pProperties = new PropertyModel(this);
+   ui->tw->setModel(m_pProperties);
+
+   m_pNodeDataTimer = new QTimer(this);
+   m_pNodeDataTimer->setSingleShot(true);
+   m_pNodeDataTimer->setInterval(0);
+
+   connect(m_pNodeDataTimer, &QTimer::timeout, this, &MainWindow::applyNodeData);
+
+   connect(m_pProperties, &PropertyModel::edited, this, &MainWindow::onPropertyEdited);
    connect(ui->tw, SIGNAL(KeyPressed(QKeyEvent*)), this, SLOT(TableKeyPressed(QKeyEvent*)));
 
-   updateNodeData(std::list<cat::Function>());
+   ui->tw->resizeColumnsToContents();
    updateInfo(m_pScene->Statistics());
 }
 
@@ -78,15 +122,96 @@ void MainWindow::createMenu()
    pMenu->addAction(pFileSaveAs);
 
    QAction* pSelectAll = new QAction(tr("&SelectAll"), this);
-   connect(pSelectAll, &QAction::triggered, this, &MainWindow::onSelectAll);
+   connect(pSelectAll, &QAction::triggered, m_pScene, &Scene::SelectAll);
+
+   QAction* pSelectNone = new QAction(tr("Select &none"), this);
+   connect(pSelectNone, &QAction::triggered, m_pScene, &Scene::SelectNone);
+
+   QAction* pInvertSelection = new QAction(tr("&Invert selection"), this);
+   connect(pInvertSelection, &QAction::triggered, m_pScene, &Scene::InvertSelection);
+
+   QAction* pSelectMatching = new QAction(tr("Select &matching..."), this);
+   connect(pSelectMatching, &QAction::triggered, this, &MainWindow::onSelectMatching);
+
+   QAction* pLayout = new QAction(tr("&Layout"), this);
+   connect(pLayout, &QAction::triggered, m_pScene, &Scene::Layout);
+
+   QAction* pBatchedEdges = new QAction(tr("&Batched edges"), this);
+   pBatchedEdges->setCheckable(true);
+   pBatchedEdges->setChecked(m_pScene->BatchedEdges());
+   connect(pBatchedEdges, &QAction::toggled, m_pScene, &Scene::SetBatchedEdges);
+
+   m_pUndo = new QAction(this);
+   m_pUndo->setShortcut(QKeySequence::Undo);
+   connect(m_pUndo, &QAction::triggered, m_pScene, &Scene::Undo);
+
+   m_pRedo = new QAction(this);
+   m_pRedo->setShortcut(QKeySequence::Redo);
+   connect(m_pRedo, &QAction::triggered, m_pScene, &Scene::Redo);
 
    auto pEditMenu = menuBar()->addMenu(tr("&Edit"));
+   pEditMenu->addAction(m_pUndo);
+   pEditMenu->addAction(m_pRedo);
+   pEditMenu->addSeparator();
    pEditMenu->addAction(pSelectAll);
+   pEditMenu->addAction(pSelectNone);
+   pEditMenu->addAction(pInvertSelection);
+   pEditMenu->addAction(pSelectMatching);
+   pEditMenu->addSeparator();
+   pEditMenu->addAction(pLayout);
+   pEditMenu->addAction(pBatchedEdges);
+
+   updateHistory();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::updateHistory()
+{
+   // Created with the menu once the first frame is shown
+   if (!m_pUndo)
+      return;
+
+   m_pUndo->setEnabled(m_pScene->CanUndo());
+   m_pUndo->setText(m_pScene->CanUndo() ? tr("&Undo %1").arg(m_pScene->UndoText()) : tr("&Undo"));
+
+   m_pRedo->setEnabled(m_pScene->CanRedo());
+   m_pRedo->setText(m_pScene->CanRedo() ? tr("&Redo %1").arg(m_pScene->RedoText()) : tr("&Redo"));
+}
+
+//----------------------------------------------------------------------
+void MainWindow::finishStartup()
+{
+   startup::Mark("first frame");
+
+   createMenu();
+
+   // Whatever the first frame queued has run by the time this is called
+   QTimer::singleShot(0, this, []()
+   {
+      startup::Mark("interactive");
+   });
+}
+
+//----------------------------------------------------------------------
+bool MainWindow::eventFilter(QObject* pWatched_, QEvent* pEvent_)
+{
+   if (pWatched_ == ui->View->viewport() && pEvent_->type() == QEvent::Paint)
+   {
+      pWatched_->removeEventFilter(this);
+
+      // Queued so that the frame is finished first
+      QTimer::singleShot(0, this, &MainWindow::finishStartup);
+   }
+
+   return QMainWindow::eventFilter(pWatched_, pEvent_);
 }
 
 //----------------------------------------------------------------------
 MainWindow::~MainWindow()
 {
+   // The rows are read from the scene
+   m_pRecords->Clear();
+
    m_pScene->DeInit();
    delete m_pScene;
    delete ui;
@@ -113,110 +238,21 @@ void MainWindow::updateInfo(const QString& str_)
 }
 
 //----------------------------------------------------------------------
-void MainWindow::updateNodeData(const std::list<cat::Function>& data_)
+void MainWindow::updateNodeData(const std::list<cat::Function>& data_, const std::set<cat::FunctionName>& mixed_)
 {
-   ui->tw->blockSignals(true);
-
-   ui->tw->setRowCount(0);
-
-   QStringList labels;
-   labels << tr("Name") << tr("Type") << tr("Value");
-   ui->tw->setHorizontalHeaderLabels(labels);
-
-   for (const auto& it : data_)
-   {
-      int new_row = ui->tw->rowCount();
-      ui->tw->insertRow(new_row);
-
-      const auto& name  = it.first.c_str();
-      const auto& value = it.second;
-
-      auto prop_name = new QTableWidgetItem(name);
-      prop_name->setFlags(prop_name->flags().setFlag(Qt::ItemIsEnabled, false));
-      prop_name->setFlags(prop_name->flags() & ~Qt::ItemIsEditable);
-
-      ui->tw->setItem(new_row, EProperty::eName, prop_name);
-
-      if (const double* pVal = std::get_if<double>(&value))
-      {
-         {
-            auto pItem = new QTableWidgetItem();
-            pItem->setData(Qt::DisplayRole, cat_types.at((int)ESetTypes::eDouble));
-            pItem->setFlags(pItem->flags().setFlag(Qt::ItemIsEnabled, false));
-
-            ui->tw->setItem(new_row, EProperty::eType, pItem);
-         }
-
-         {
-            auto pItem = new QTableWidgetItem();
-
-            pItem->setData(Qt::DisplayRole, *pVal);
-
-            ui->tw->setItem(new_row, EProperty::eValue, pItem);
-            pItem->setToolTip(QString::number(*pVal));
-         }
-      }
-      else if (const float* pVal = std::get_if<float>(&value))
-      {
-         {
-            auto pItem = new QTableWidgetItem();
-            pItem->setData(Qt::DisplayRole, cat_types.at((int)ESetTypes::eFloat));
-            pItem->setFlags(pItem->flags().setFlag(Qt::ItemIsEnabled, false));
-
-            ui->tw->setItem(new_row, EProperty::eType, pItem);
-         }
-
-         {
-            auto pItem = new QTableWidgetItem();
-
-            pItem->setData(Qt::DisplayRole, *pVal);
-
-            ui->tw->setItem(new_row, EProperty::eValue, pItem);
-            pItem->setToolTip(QString::number(*pVal));
-         }
-      }
-      else if (const int* pVal = std::get_if<int>(&value))
-      {
-         {
-            auto pItem = new QTableWidgetItem();
-            pItem->setData(Qt::DisplayRole, cat_types.at((int)ESetTypes::eInt));
-            pItem->setFlags(pItem->flags().setFlag(Qt::ItemIsEnabled, false));
-
-            ui->tw->setItem(new_row, EProperty::eType, pItem);
-         }
-
-         {
-            auto pItem = new QTableWidgetItem();
-
-            pItem->setData(Qt::DisplayRole, *pVal);
-
-            ui->tw->setItem(new_row, EProperty::eValue, pItem);
-            pItem->setToolTip(QString::number(*pVal));
-         }
-      }
-      else if (const std::string* pVal = std::get_if<std::string>(&value))
-      {
-         {
-            auto pItem = new QTableWidgetItem();
-            pItem->setData(Qt::DisplayRole, cat_types.at((int)ESetTypes::eString));
-            pItem->setFlags(pItem->flags().setFlag(Qt::ItemIsEnabled, false));
+   // Bursts of updates are applied once per event loop turn
+   m_nodeData  = data_;
+   m_nodeMixed = mixed_;
 
-            ui->tw->setItem(new_row, EProperty::eType, pItem);
-         }
-
-         {
-            auto pItem = new QTableWidgetItem();
-
-            pItem->setData(Qt::DisplayRole, QString((*pVal).c_str()));
-            pItem->setToolTip(QString((*pVal).c_str()));
-
-            ui->tw->setItem(new_row, EProperty::eValue, pItem);
-         }
-      }
-   }
+   if (!m_pNodeDataTimer->isActive())
+      m_pNodeDataTimer->start();
+}
 
-   ui->tw->resizeColumnsToContents();
-   ui->tw->blockSignals(false);
+//----------------------------------------------------------------------
+void MainWindow::applyNodeData()
+{
+   if (m_pProperties->SetProperties(m_nodeData, m_nodeMixed))
+      ui->tw->resizeColumnsToContents();
 }
 
 //----------------------------------------------------------------------
@@ -224,6 +260,7 @@ void MainWindow::onNew()
 {
    m_pScene->New();
 
+   m_savingFile .clear();
    m_currentFile.clear();
    setWindowTitle(m_currentFile);
 }
@@ -237,7 +274,13 @@ void MainWindow::onImport()
 
    m_pScene->New();
 
-   m_pScene->Build(fileName);
+   m_savingFile .clear();
+   m_loadingFile.clear();
+   m_pScene->LoadAsync(fileName, Loader::EFormat::eText);
+
+   m_pProgress ->setRange(0, 0);
+   m_pProgress ->show();
+   m_pCancel   ->show();
 }
 
 //----------------------------------------------------------------------
@@ -249,23 +292,61 @@ void MainWindow::onLoad()
 
    m_pScene->New();
 
-   if (m_pScene->LoadBinary(fileName))
+   m_savingFile .clear();
+   m_currentFile.clear();
+   setWindowTitle(m_currentFile);
+
+   m_loadingFile = fileName;
+   m_pScene->LoadAsync(fileName, Loader::EFormat::eBinary);
+
+   m_pProgress ->setRange(0, 0);
+   m_pProgress ->show();
+   m_pCancel   ->show();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::onLoadProgress(int done_, int total_)
+{
+   m_pProgress->setRange(0, total_);
+   m_pProgress->setValue(done_);
+}
+
+//----------------------------------------------------------------------
+void MainWindow::onLoadFinished(bool ok_)
+{
+   m_pProgress ->hide();
+   m_pCancel   ->hide();
+
+   if (ok_)
    {
-      m_currentFile = fileName;
-      setWindowTitle(m_currentFile);
+      if (!m_loadingFile.isEmpty())
+      {
+         m_currentFile = m_loadingFile;
+         setWindowTitle(m_currentFile);
+      }
    }
    else
    {
-      m_currentFile.clear();
-      setWindowTitle(m_currentFile);
+      // Dropping the partially loaded items
+      m_pScene->New();
    }
+
+   m_loadingFile.clear();
+}
+
+//----------------------------------------------------------------------
+void MainWindow::onCancelLoad()
+{
+   m_pScene->CancelLoad();
 }
 
 //----------------------------------------------------------------------
 void MainWindow::onSave()
 {
-   if (!m_pScene->SaveBinary(m_currentFile))
+   if (m_currentFile.isEmpty())
       onSaveAs();
+   else
+      save(m_currentFile);
 }
 
 //----------------------------------------------------------------------
@@ -277,103 +358,114 @@ void MainWindow::onSaveAs()
 
    fileName = fileName.contains(".dat") ? fileName : fileName + ".dat";
 
-   if (m_pScene->SaveBinary(fileName))
-      m_currentFile = fileName;
-   else
-      m_currentFile.clear();
+   save(fileName);
 }
 
 //----------------------------------------------------------------------
-void MainWindow::onSelectAll()
+void MainWindow::save(const QString& path_)
 {
-   const QList<QGraphicsItem*>& items = m_pScene->items();
-   for (const auto& it : items)
-      it->setSelected(true);
+   m_savingFile = path_;
+
+   m_pScene->SaveAsync(path_);
+
+   m_pSaveProgress->setRange(0, 0);
+   m_pSaveProgress->show();
 }
 
 //----------------------------------------------------------------------
-void MainWindow::onTableItemChanged(int row_, int col_)
+void MainWindow::onSaveProgress(int done_, int total_)
 {
-   QTableWidgetItem* pItemName   = ui->tw->item(row_, EProperty::eName);
-   QTableWidgetItem* pItemType   = ui->tw->item(row_, EProperty::eType);
-   QTableWidgetItem* pItem       = ui->tw->item(row_, EProperty::eValue);
-
-   Function fn;
-   fn.first = pItemName->text().toStdString();
-
-   if       (pItemType->data(Qt::DisplayRole).toString() == cat_types.at((int)ESetTypes::eInt))
-      fn.second = pItem->data(Qt::DisplayRole).value<int>();
-   else if  (pItemType->data(Qt::DisplayRole).toString() == cat_types.at((int)ESetTypes::eFloat))
-      fn.second = pItem->data(Qt::DisplayRole).value<float>();
-   else if  (pItemType->data(Qt::DisplayRole).toString() == cat_types.at((int)ESetTypes::eDouble))
-      fn.second = pItem->data(Qt::DisplayRole).value<double>();
-   else if  (pItemType->data(Qt::DisplayRole).toString() == cat_types.at((int)ESetTypes::eString))
-      fn.second = pItem->data(Qt::DisplayRole).value<QString>().toStdString();
-
-   m_pScene->RemovePropertyFromNode(nullptr, fn.first);
-   m_pScene->AddProperty2Node(nullptr, fn);
+   m_pSaveProgress->setRange(0, total_);
+   m_pSaveProgress->setValue(done_);
 }
 
 //----------------------------------------------------------------------
-void MainWindow::TableKeyPressed(QKeyEvent* pKeyEvent_)
+void MainWindow::onSaveFinished(bool ok_, const QString& path_, const QString& error_)
 {
-   if (pKeyEvent_->key() == Qt::Key_Delete)
+   // A save requested meanwhile may already be running
+   if (!m_pScene->IsSaving())
+      m_pSaveProgress->hide();
+
+   if (!ok_)
    {
-      if (QTableWidgetItem* pItem = ui->tw->item(ui->tw->currentRow(), eName))
-      {
-         m_pScene->RemovePropertyFromNode(nullptr, pItem->text().toStdString());
-         ui->tw->removeRow(ui->tw->currentRow());
-      }
+      QMessageBox::warning(this, tr("Save"), tr("%1 could not be saved: %2").arg(path_, error_));
+      return;
+   }
+
+   statusBar()->showMessage(tr("Saved %1").arg(path_), 5000);
+
+   // Unless another document was opened meanwhile
+   if (path_ == m_savingFile)
+   {
+      m_currentFile = path_;
+      setWindowTitle(m_currentFile);
    }
 }
 
 //----------------------------------------------------------------------
-void MainWindow::on_leFilter_editingFinished()
+void MainWindow::onSelectMatching()
 {
-   m_pScene->Filter(ui->leFilter->text());
+   bool ok {};
+   QString filter = QInputDialog::getText(this, tr("Select matching"), tr("Filter"), QLineEdit::Normal, ui->leFilter->text(), &ok);
 
-   ui->twTable->clear();
-   ui->twTable->setRowCount(0);
+   if (ok && !m_pScene->SelectMatching(filter))
+      QMessageBox::warning(this, tr("Select matching"), tr("Invalid filter"));
+}
 
-   QSet<QString> headers;
+//----------------------------------------------------------------------
+void MainWindow::onPropertyEdited(const cat::Function& property_)
+{
+   // Replaces the previous value on all selected nodes at once
+   m_pScene->AddProperty2Node(nullptr, property_);
+}
 
-   for (auto& it : m_pScene->GetDescription())
+//----------------------------------------------------------------------
+void MainWindow::TableKeyPressed(QKeyEvent* pKeyEvent_)
+{
+   if (pKeyEvent_->key() == Qt::Key_Delete)
    {
-      for (QMap<QString, QString>::iterator rec = it.begin(); rec != it.end(); ++rec)
-      {
-         headers.insert(rec.key());
-      }
+      // From all selected nodes, the row goes with the next update of the
+      // node data
+      auto name = m_pProperties->Name(ui->tw->currentIndex().row());
+      if (!name.empty())
+         m_pScene->RemovePropertyFromNode(nullptr, name);
    }
+}
 
-   QStringList labels;
-   for (const auto& it : headers)
-      labels.push_back(it);
-   
-   ui->twTable->setColumnCount(labels.size());
+//----------------------------------------------------------------------
+void MainWindow::on_leFilter_editingFinished()
+{
+   m_pScene->Filter(ui->leFilter->text());
 
-   ui->twTable->setHorizontalHeaderLabels(labels);
+   // Only the ids are collected, the view reads the cells it shows
+   m_pRecords->Reset(m_pScene->VisibleNodes());
 
-   for (auto& it : m_pScene->GetDescription())
-   {
-      int new_row = ui->twTable->rowCount();
-      ui->twTable->insertRow(new_row);
+   QHeaderView* pHeader = ui->twTable->horizontalHeader();
+   ui->twTable->sortByColumn(pHeader->sortIndicatorSection(), pHeader->sortIndicatorOrder());
 
-      int count{};
-      for (QMap<QString, QString>::iterator rec = it.begin(); rec != it.end(); ++rec)
-      {
-         auto pItem = new QTableWidgetItem();
+   m_tableActive = true;
 
-         pItem->setData(Qt::DisplayRole, rec.value());
+   ui->twTable->resizeColumnsToContents();
+}
 
-         headers.find(rec.key());
+//----------------------------------------------------------------------
+void MainWindow::updateRecords(const QStringList& shown_, const QStringList& hidden_)
+{
+   // Only a table filled by a filter is kept in step
+   if (!m_tableActive)
+      return;
 
-         auto pos = std::distance(headers.begin(), headers.find(rec.key()));
+   m_pRecords->Update(shown_, hidden_);
+}
 
-         ui->twTable->setItem(new_row, pos, pItem);
-      }
-   }
+//----------------------------------------------------------------------
+void MainWindow::onDocumentClosed()
+{
+   // Rows and columns are of the closed document, the table waits for the
+   // next filter
+   m_pRecords->Clear();
 
-   ui->twTable->resizeColumnsToContents();
+   m_tableActive = false;
 }
 
 //----------------------------------------------------------------------
@@ -1,7 +1,10 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <set>
+
 #include <QMainWindow>
+#include <QStringList>
 
 #include "node.h"
 
@@ -12,6 +15,12 @@ QT_END_NAMESPACE
 class Scene;
 class QContextMenuEvent;
 class QTableWidgetItem;
+class QProgressBar;
+class QPushButton;
+class QAction;
+class RecordModel;
+class PropertyModel;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
@@ -24,28 +33,59 @@ public:
 protected:
     void keyPressEvent(QKeyEvent* pEvent_) override;
     void resizeEvent(QResizeEvent* pEvent_) override;
+    bool eventFilter(QObject* pWatched_, QEvent* pEvent_) override;
 
 private slots:
    void on_leShowLabel_editingFinished();
    void on_pbSaveImage_clicked();
    void updateInfo(const QString& str_);
-   void updateNodeData(const std::list<cat::Function>& data_);
+   void updateNodeData(const std::list<cat::Function>& data_, const std::set<cat::FunctionName>& mixed_);
    void onNew();
    void onImport();
    void onLoad();
    void onSave();
    void onSaveAs();
-   void onSelectAll();
-   void onTableItemChanged(int row_, int col_);
+   void onSelectMatching();
+   void applyNodeData();
+   void onPropertyEdited(const cat::Function& property_);
    void TableKeyPressed(QKeyEvent* pKeyEvent_);
    void on_leFilter_editingFinished();
+   void onLoadProgress(int done_, int total_);
+   void onLoadFinished(bool ok_);
+   void onCancelLoad();
+   void onSaveProgress(int done_, int total_);
+   void onSaveFinished(bool ok_, const QString& path_, const QString& error_);
+   void updateHistory();
+   void updateRecords(const QStringList& shown_, const QStringList& hidden_);
+   void onDocumentClosed();
 
 private:
    void createMenu();
+   void finishStartup();
+   void save(const QString& path_);
 
    Ui::MainWindow*   ui       {};
-   Scene*            m_pScene {};
+   Scene*            m_pScene    {};
    QString           m_currentFile;
+   QString           m_loadingFile;
+   QString           m_savingFile;
+   QProgressBar*     m_pProgress {};
+   QPushButton*      m_pCancel   {};
+   QProgressBar*     m_pSaveProgress {};
+   QAction*          m_pUndo     {};
+   QAction*          m_pRedo     {};
+
+   // Rows of tw, the last node data is applied once per event loop turn
+   PropertyModel*    m_pProperties {};
+   QTimer*           m_pNodeDataTimer {};
+   std::list<cat::Function>
+                     m_nodeData;
+   std::set<cat::FunctionName>
+                     m_nodeMixed;
+
+   // Rows of twTable, patched on edits
+   RecordModel*      m_pRecords  {};
+   bool              m_tableActive {};
 };
 
 #endif
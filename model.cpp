@@ -0,0 +1,96 @@
+#include "model.h"
+
+#include <QUuid>
+
+#include <atomic>
+
+using namespace cat;
+
+//----------------------------------------------------------------------
+std::string model::UniqueName()
+{
+   // One uuid per session, names within it only differ by a counter
+   static const std::string session = []()
+   {
+      QString ret = QUuid::createUuid().toString();
+
+      return "n" + ret.replace('-','_').mid(1, 36).toStdString() + "_";
+   }();
+
+   static std::atomic<uint64_t> counter {};
+
+   return session + std::to_string(counter++);
+}
+
+//----------------------------------------------------------------------
+std::list<Function> model::FunctionValues(const std::string& source_, const std::string& target_, Node& category_)
+{
+   Arrow::List morphisms = category_.QueryArrows(Arrow(source_, target_, "*").AsQuery());
+   if (morphisms.empty())
+      return std::list<Function>();
+
+   return ArrowValues(morphisms.front(), category_);
+}
+
+//----------------------------------------------------------------------
+std::list<Function> model::ArrowValues(const Arrow& arrow_, Node& category_)
+{
+   auto target = category_.QueryNodes(arrow_.Target());
+   if (target.empty())
+      return std::list<Function>();
+
+   std::list<Function> fns;
+
+   for (const auto& function : arrow_.QueryArrows(Arrow("*", "*", "*").AsQuery()))
+   {
+      auto vals = target.front().QueryNodes(function.Target());
+      if (!vals.empty())
+         fns.emplace_back(function.Name(), vals.front().GetValue());
+   }
+
+   return fns;
+}
+
+//----------------------------------------------------------------------
+QString model::ToString(const TSetValue& value_)
+{
+   if (const double* pVal = std::get_if<double>(&value_))
+      return QString::number(*pVal);
+   else if (const float* pVal = std::get_if<float>(&value_))
+      return QString::number(*pVal);
+   else if (const int* pVal = std::get_if<int>(&value_))
+      return QString::number(*pVal);
+   else if (const std::string* pVal = std::get_if<std::string>(&value_))
+      return QString((*pVal).c_str());
+
+   return QString();
+}
+
+//----------------------------------------------------------------------
+bool model::AddArrow(Node& category_, Arrow& arrow_, const std::list<Function>& fns_)
+{
+   if (!fns_.empty())
+   {
+      Node::List nodes = category_.QueryNodes(arrow_.Target());
+      if (nodes.empty())
+         return false;
+
+      for (const auto& it : fns_)
+      {
+         auto target_set = UniqueName();
+
+         arrow_.AddArrow(Arrow(sVoid, target_set, it.first));
+
+         Node node = Node(target_set, Node::EType::eSet);
+         node.SetValue(it.second);
+
+         nodes.front().AddNode(node);
+      }
+
+      category_.ReplaceNode(nodes.front());
+   }
+   else if (category_.QueryNodes(arrow_.Target()).empty())
+      return false;
+
+   return category_.AddArrow(arrow_);
+}
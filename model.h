@@ -0,0 +1,36 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <list>
+#include <string>
+
+#include <QString>
+
+#include "node.h"
+
+// Cat model helpers shared by the scene and the background jobs
+namespace model
+{
+   constexpr const char* x_token    = "x_";
+   constexpr const char* y_token    = "y_";
+   constexpr const char* id_token   = "id_";
+
+   constexpr const char* sSet       = "set";
+   constexpr const char* sVoid      = "void";
+
+   std::string UniqueName();
+
+   // Properties carried by the source -> target morphism
+   std::list<cat::Function> FunctionValues(const std::string& source_, const std::string& target_, cat::Node& category_);
+
+   // Properties carried by the arrow, the values are read from its target node
+   std::list<cat::Function> ArrowValues(const cat::Arrow& arrow_, cat::Node& category_);
+
+   // Display form of a property value
+   QString ToString(const cat::TSetValue& value_);
+
+   // Adds the arrow together with its properties, the values are stored in the target node
+   bool AddArrow(cat::Node& category_, cat::Arrow& arrow_, const std::list<cat::Function>& fns_);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Splits [0, count_) into contiguous chunks processed on all hardware threads,
+// fn_(begin, end) runs once per chunk and the call returns when all are done
+template <typename TFn>
+void parallel_for(size_t count_, const TFn& fn_, size_t min_chunk_ = 1024)
+{
+   size_t threads = std::max(1u, std::thread::hardware_concurrency());
+   threads = std::min(threads, (count_ + min_chunk_ - 1) / min_chunk_);
+
+   if (threads <= 1)
+   {
+      fn_(size_t(0), count_);
+      return;
+   }
+
+   size_t chunk = (count_ + threads - 1) / threads;
+
+   std::vector<std::thread> pool;
+   pool.reserve(threads - 1);
+
+   for (size_t t = 1; t < threads; ++t)
+      pool.emplace_back(fn_, std::min(t * chunk, count_), std::min((t + 1) * chunk, count_));
+
+   fn_(size_t(0), std::min(chunk, count_));
+
+   for (auto& thread : pool)
+      thread.join();
+}
+
+#endif
@@ -0,0 +1,192 @@
+#include "propertymodel.h"
+
+#include <QFont>
+
+#include "common.h"
+#include "model.h"
+
+using namespace cat;
+
+//----------------------------------------------------------------------
+PropertyModel::PropertyModel(QObject* pParent_) :
+   QAbstractTableModel(pParent_)
+{
+}
+
+//----------------------------------------------------------------------
+bool PropertyModel::SetProperties(const std::list<Function>& fns_, const std::set<FunctionName>& mixed_)
+{
+   bool structural {};
+
+   // Both sides are ordered by name, walked in step
+   int   row = 0;
+   auto  it  = fns_.begin();
+
+   while (row < (int)m_rows.size() || it != fns_.end())
+   {
+      if (it == fns_.end() || (row < (int)m_rows.size() && m_rows[row].fn.first < it->first))
+      {
+         beginRemoveRows(QModelIndex(), row, row);
+         m_rows.erase(m_rows.begin() + row);
+         endRemoveRows();
+
+         structural = true;
+      }
+      else if (row == (int)m_rows.size() || it->first < m_rows[row].fn.first)
+      {
+         beginInsertRows(QModelIndex(), row, row);
+         m_rows.insert(m_rows.begin() + row, Row{ *it, mixed_.count(it->first) > 0 });
+         endInsertRows();
+
+         structural = true;
+
+         ++row;
+         ++it;
+      }
+      else
+      {
+         Row& current = m_rows[row];
+         bool mixed   = mixed_.count(it->first) > 0;
+
+         if (current.fn.second != it->second || current.mixed != mixed)
+         {
+            current.fn.second = it->second;
+            current.mixed     = mixed;
+
+            emit dataChanged(index(row, eType), index(row, eValue));
+         }
+
+         ++row;
+         ++it;
+      }
+   }
+
+   return structural;
+}
+
+//----------------------------------------------------------------------
+FunctionName PropertyModel::Name(int row_) const
+{
+   return row_ >= 0 && row_ < (int)m_rows.size() ? m_rows[row_].fn.first : FunctionName();
+}
+
+//----------------------------------------------------------------------
+int PropertyModel::rowCount(const QModelIndex& parent_) const
+{
+   return parent_.isValid() ? 0 : (int)m_rows.size();
+}
+
+//----------------------------------------------------------------------
+int PropertyModel::columnCount(const QModelIndex& parent_) const
+{
+   return parent_.isValid() ? 0 : eColumns;
+}
+
+//----------------------------------------------------------------------
+QVariant PropertyModel::data(const QModelIndex& index_, int role_) const
+{
+   if (!index_.isValid())
+      return QVariant();
+
+   const auto& [fn, mixed] = m_rows[index_.row()];
+   const auto& [name, value] = fn;
+
+   if (index_.column() == eValue && mixed)
+   {
+      // The editor still gets a value of the type to edit
+      if (role_ == Qt::DisplayRole)
+         return tr("<mixed>");
+
+      if (role_ == Qt::ToolTipRole)
+         return tr("The selected nodes differ");
+
+      if (role_ == Qt::FontRole)
+      {
+         QFont font;
+         font.setItalic(true);
+         return font;
+      }
+   }
+
+   if (role_ == Qt::ToolTipRole && index_.column() == eValue)
+      return model::ToString(value);
+
+   if (role_ != Qt::DisplayRole && role_ != Qt::EditRole)
+      return QVariant();
+
+   switch (index_.column())
+   {
+   case eName:
+      return QString::fromStdString(name);
+
+   case eType:
+      return (int)value.index() < cat_types.size() ? cat_types.at((int)value.index()) : QVariant();
+
+   case eValue:
+      // Typed, so that the view edits numbers with spin boxes
+      if (const double* pVal = std::get_if<double>(&value))
+         return *pVal;
+      else if (const float* pVal = std::get_if<float>(&value))
+         return *pVal;
+      else if (const int* pVal = std::get_if<int>(&value))
+         return *pVal;
+      else if (const std::string* pVal = std::get_if<std::string>(&value))
+         return QString::fromStdString(*pVal);
+      break;
+
+   default:
+      break;
+   }
+
+   return QVariant();
+}
+
+//----------------------------------------------------------------------
+QVariant PropertyModel::headerData(int section_, Qt::Orientation orientation_, int role_) const
+{
+   if (orientation_ != Qt::Horizontal || role_ != Qt::DisplayRole)
+      return QAbstractTableModel::headerData(section_, orientation_, role_);
+
+   switch (section_)
+   {
+   case eName:    return tr("Name");
+   case eType:    return tr("Type");
+   case eValue:   return tr("Value");
+   default:       return QVariant();
+   }
+}
+
+//----------------------------------------------------------------------
+Qt::ItemFlags PropertyModel::flags(const QModelIndex& index_) const
+{
+   if (!index_.isValid())
+      return Qt::NoItemFlags;
+
+   // Names and types are shown greyed out, only values are edited
+   if (index_.column() != eValue)
+      return Qt::ItemIsSelectable;
+
+   return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+}
+
+//----------------------------------------------------------------------
+bool PropertyModel::setData(const QModelIndex& index_, const QVariant& value_, int role_)
+{
+   if (!index_.isValid() || index_.column() != eValue || role_ != Qt::EditRole)
+      return false;
+
+   Function fn = m_rows[index_.row()].fn;
+
+   if (std::holds_alternative<int>(fn.second))
+      fn.second = value_.value<int>();
+   else if (std::holds_alternative<float>(fn.second))
+      fn.second = value_.value<float>();
+   else if (std::holds_alternative<double>(fn.second))
+      fn.second = value_.value<double>();
+   else if (std::holds_alternative<std::string>(fn.second))
+      fn.second = value_.toString().toStdString();
+
+   emit edited(fn);
+
+   return true;
+}
@@ -0,0 +1,58 @@
+#ifndef PROPERTYMODEL_H
+#define PROPERTYMODEL_H
+
+#include <set>
+#include <vector>
+
+#include <QAbstractTableModel>
+
+#include "node.h"
+
+// Properties of the selected nodes as name, type and value rows, ordered by
+// name. A new set of properties is diffed against the shown one, only the
+// rows inserted, removed or changed are signalled to the view. Properties
+// the nodes do not share a value of are shown as mixed, editing one sets
+// it on all of them.
+class PropertyModel : public QAbstractTableModel
+{
+   Q_OBJECT
+
+public:
+   enum EColumn
+   {
+         eName = 0
+      ,  eType
+      ,  eValue
+      ,  eColumns
+   };
+
+   PropertyModel(QObject* pParent_ = nullptr);
+
+   // Expects the properties ordered by name, as the property store returns
+   // them. Returns whether rows were inserted or removed.
+   bool SetProperties(const std::list<cat::Function>& fns_, const std::set<cat::FunctionName>& mixed_ = {});
+
+   cat::FunctionName Name(int row_) const;
+
+   int rowCount(const QModelIndex& parent_ = QModelIndex()) const override;
+   int columnCount(const QModelIndex& parent_ = QModelIndex()) const override;
+   QVariant data(const QModelIndex& index_, int role_ = Qt::DisplayRole) const override;
+   QVariant headerData(int section_, Qt::Orientation orientation_, int role_ = Qt::DisplayRole) const override;
+   Qt::ItemFlags flags(const QModelIndex& index_) const override;
+   bool setData(const QModelIndex& index_, const QVariant& value_, int role_ = Qt::EditRole) override;
+
+signals:
+   // A value edited in the view, the row changes once the scene applies it
+   void edited(const cat::Function& property_);
+
+private:
+   struct Row
+   {
+      cat::Function              fn;
+      bool                       mixed    {};
+   };
+
+   std::vector<Row>           m_rows;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "propertystore.h"
+
+using namespace cat;
+
+//----------------------------------------------------------------------
+void PropertyStore::Clear()
+{
+   m_rows   .clear();
+   m_free   .clear();
+   m_names  .clear();
+   m_columns.clear();
+
+   m_size = 0;
+}
+
+//----------------------------------------------------------------------
+int PropertyStore::Insert(const std::string& node_)
+{
+   auto it = m_rows.find(node_);
+   if (it != m_rows.end())
+      return it->second;
+
+   int row {};
+
+   if (!m_free.empty())
+   {
+      row = m_free.back();
+      m_free.pop_back();
+   }
+   else
+   {
+      row = (int)m_size++;
+   }
+
+   m_rows.emplace(node_, row);
+
+   return row;
+}
+
+//----------------------------------------------------------------------
+void PropertyStore::Erase(const std::string& node_)
+{
+   auto it = m_rows.find(node_);
+   if (it == m_rows.end())
+      return;
+
+   Assign(it->second, std::list<Function>());
+
+   m_free.push_back(it->second);
+   m_rows.erase(it);
+}
+
+//----------------------------------------------------------------------
+int PropertyStore::Row(const std::string& node_) const
+{
+   auto it = m_rows.find(node_);
+
+   return it != m_rows.end() ? it->second : npos;
+}
+
+//----------------------------------------------------------------------
+size_t PropertyStore::Rows() const
+{
+   return m_size;
+}
+
+//----------------------------------------------------------------------
+int PropertyStore::Column(const FunctionName& name_) const
+{
+   auto it = m_names.find(name_);
+
+   return it != m_names.end() ? it->second : npos;
+}
+
+//----------------------------------------------------------------------
+const std::map<FunctionName, int>& PropertyStore::Names() const
+{
+   return m_names;
+}
+
+//----------------------------------------------------------------------
+void PropertyStore::Set(int row_, const FunctionName& name_, const TSetValue& value_)
+{
+   if (row_ < 0)
+      return;
+
+   Field& field = m_columns[addColumn(name_)];
+
+   if (field.values.size() <= (size_t)row_)
+   {
+      field.values  .resize(m_size);
+      field.present .resize(m_size, 0);
+   }
+
+   field.values  [row_] = value_;
+   field.present [row_] = 1;
+}
+
+//----------------------------------------------------------------------
+void PropertyStore::Remove(int row_, const FunctionName& name_)
+{
+   int index = Column(name_);
+   if (row_ < 0 || index < 0)
+      return;
+
+   Field& field = m_columns[index];
+
+   if ((size_t)row_ < field.present.size())
+   {
+      field.values  [row_] = TSetValue();
+      field.present [row_] = 0;
+   }
+}
+
+//----------------------------------------------------------------------
+void PropertyStore::Assign(int row_, const std::list<Function>& fns_)
+{
+   if (row_ < 0)
+      return;
+
+   for (Field& field : m_columns)
+   {
+      if ((size_t)row_ < field.present.size() && field.present[row_])
+      {
+         field.values  [row_] = TSetValue();
+         field.present [row_] = 0;
+      }
+   }
+
+   for (const Function& fn : fns_)
+      Set(row_, fn.first, fn.second);
+}
+
+//----------------------------------------------------------------------
+const TSetValue* PropertyStore::Get(int row_, int column_) const
+{
+   if (row_ < 0 || column_ < 0 || (size_t)column_ >= m_columns.size())
+      return nullptr;
+
+   const Field& field = m_columns[column_];
+
+   if ((size_t)row_ >= field.present.size() || !field.present[row_])
+      return nullptr;
+
+   return &field.values[row_];
+}
+
+//----------------------------------------------------------------------
+const TSetValue* PropertyStore::Get(int row_, const FunctionName& name_) const
+{
+   return Get(row_, Column(name_));
+}
+
+//----------------------------------------------------------------------
+std::list<Function> PropertyStore::Values(int row_) const
+{
+   std::list<Function> fns;
+
+   for (const auto& [name, index] : m_names)
+   {
+      if (const TSetValue* pValue = Get(row_, index))
+         fns.emplace_back(name, *pValue);
+   }
+
+   return fns;
+}
+
+//----------------------------------------------------------------------
+std::list<Function> PropertyStore::Values(const std::vector<int>& rows_, std::set<FunctionName>& mixed_) const
+{
+   std::list<Function> fns;
+
+   for (const auto& [name, index] : m_names)
+   {
+      const TSetValue*  pFirst   {};
+      bool              mixed    {};
+
+      for (int row : rows_)
+      {
+         const TSetValue* pValue = Get(row, index);
+
+         if (!pValue)
+            mixed = true;
+         else if (!pFirst)
+            pFirst = pValue;
+         else if (*pValue != *pFirst)
+            mixed = true;
+
+         if (pFirst && mixed)
+            break;
+      }
+
+      if (!pFirst)
+         continue;
+
+      fns.emplace_back(name, *pFirst);
+
+      if (mixed)
+         mixed_.insert(name);
+   }
+
+   return fns;
+}
+
+//----------------------------------------------------------------------
+int PropertyStore::addColumn(const FunctionName& name_)
+{
+   auto [it, inserted] = m_names.emplace(name_, (int)m_columns.size());
+
+   if (inserted)
+      m_columns.emplace_back();
+
+   return it->second;
+}
@@ -0,0 +1,74 @@
+#ifndef PROPERTYSTORE_H
+#define PROPERTYSTORE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "node.h"
+
+// Columnar mirror of the node properties held by the node -> "set" morphisms.
+// Each node with such a morphism owns a row, each property name a column of
+// values indexed by row. The cat model stays authoritative, the store is kept
+// in sync by the scene so that reads do not have to query it.
+class PropertyStore
+{
+public:
+   static constexpr int npos = -1;
+
+   void Clear();
+
+   // Row of the node, created empty when missing
+   int Insert(const std::string& node_);
+   void Erase(const std::string& node_);
+
+   // Row of the node or npos
+   int Row(const std::string& node_) const;
+   size_t Rows() const;
+
+   // Column of the property or npos
+   int Column(const cat::FunctionName& name_) const;
+
+   // Property names with their column, ordered by name
+   const std::map<cat::FunctionName, int>& Names() const;
+
+   void Set(int row_, const cat::FunctionName& name_, const cat::TSetValue& value_);
+   void Remove(int row_, const cat::FunctionName& name_);
+
+   // Replaces all properties of the row
+   void Assign(int row_, const std::list<cat::Function>& fns_);
+
+   // Value or null when the row has no such property
+   const cat::TSetValue* Get(int row_, int column_) const;
+   const cat::TSetValue* Get(int row_, const cat::FunctionName& name_) const;
+
+   // Properties of the row ordered by name
+   std::list<cat::Function> Values(int row_) const;
+
+   // Properties set on any of the rows ordered by name, with the value of
+   // the first row having it. Names whose rows differ in value, or that some
+   // rows lack, go to mixed_. Read column by column, no row is copied.
+   std::list<cat::Function> Values(const std::vector<int>& rows_, std::set<cat::FunctionName>& mixed_) const;
+
+private:
+   struct Field
+   {
+      std::vector<cat::TSetValue>   values;
+      std::vector<uint8_t>          present;
+   };
+
+   int addColumn(const cat::FunctionName& name_);
+
+   std::unordered_map<std::string, int>   m_rows;
+   std::vector<int>                       m_free;
+   size_t                                 m_size      {};
+
+   std::map<cat::FunctionName, int>       m_names;
+   std::vector<Field>                     m_columns;
+};
+
+#endif
@@ -0,0 +1,349 @@
+#include "recordmodel.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+#include "model.h"
+
+using namespace cat;
+
+static const char* const   id_column      = "id";
+
+//----------------------------------------------------------------------
+static bool toNumber(const TSetValue& value_, double& number_)
+{
+   if (const double* pVal = std::get_if<double>(&value_))
+      number_ = *pVal;
+   else if (const float* pVal = std::get_if<float>(&value_))
+      number_ = *pVal;
+   else if (const int* pVal = std::get_if<int>(&value_))
+      number_ = *pVal;
+   else
+      return false;
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+// Numbers compare by value and go before strings, cells without a value last
+static bool less(const TSetValue* pLeft_, const TSetValue* pRight_)
+{
+   if (!pLeft_ || !pRight_)
+      return pLeft_ && !pRight_;
+
+   double left {}, right {};
+
+   bool left_number  = toNumber(*pLeft_, left);
+   bool right_number = toNumber(*pRight_, right);
+
+   if (left_number && right_number)
+      return left < right;
+
+   if (left_number != right_number)
+      return left_number;
+
+   const std::string* pLeft   = std::get_if<std::string>(pLeft_);
+   const std::string* pRight  = std::get_if<std::string>(pRight_);
+
+   return pLeft && pRight && *pLeft < *pRight;
+}
+
+//----------------------------------------------------------------------
+RecordModel::RecordModel(const PropertyStore& store_, QObject* pParent_) :
+   QAbstractTableModel(pParent_),
+   m_store(store_)
+{
+}
+
+//----------------------------------------------------------------------
+void RecordModel::Clear()
+{
+   Reset(QStringList());
+}
+
+//----------------------------------------------------------------------
+void RecordModel::Reset(const QStringList& ids_)
+{
+   beginResetModel();
+
+   m_ids.clear();
+   m_rows.clear();
+
+   m_ids.reserve(ids_.size());
+   m_rows.reserve(ids_.size());
+
+   for (const QString& id : ids_)
+   {
+      if (m_rows.emplace(id.toStdString(), (int)m_ids.size()).second)
+         m_ids.push_back(id.toStdString());
+   }
+
+   m_headers = QStringList{ id_column };
+   m_fields  = { PropertyStore::npos };
+   m_columns = { { id_column, 0 } };
+
+   std::vector<int> rows(m_ids.size());
+   std::transform(m_ids.begin(), m_ids.end(), rows.begin(), [this](const std::string& id_) { return m_store.Row(id_); });
+
+   addColumns(rows, false);
+
+   endResetModel();
+}
+
+//----------------------------------------------------------------------
+void RecordModel::Update(const QStringList& shown_, const QStringList& hidden_)
+{
+   std::vector<int> hidden;
+
+   for (const QString& id : hidden_)
+   {
+      auto it = m_rows.find(id.toStdString());
+      if (it != m_rows.end())
+         hidden.push_back(it->second);
+   }
+
+   removeRows(std::move(hidden));
+
+   std::vector<int>           rows;
+   std::vector<std::string>   added;
+
+   int first = rowCount();
+   int last  = -1;
+
+   for (const QString& id : shown_)
+   {
+      std::string name = id.toStdString();
+
+      rows.push_back(m_store.Row(name));
+
+      auto it = m_rows.find(name);
+      if (it != m_rows.end())
+      {
+         first = std::min(first, it->second);
+         last  = std::max(last,  it->second);
+      }
+      else if (m_rows.emplace(name, int(m_ids.size() + added.size())).second)
+      {
+         added.push_back(std::move(name));
+      }
+   }
+
+   if (!added.empty())
+   {
+      beginInsertRows(QModelIndex(), (int)m_ids.size(), int(m_ids.size() + added.size()) - 1);
+
+      std::move(added.begin(), added.end(), std::back_inserter(m_ids));
+
+      endInsertRows();
+   }
+
+   addColumns(rows, true);
+
+   if (first <= last)
+      emit dataChanged(index(first, 0), index(last, columnCount() - 1));
+}
+
+//----------------------------------------------------------------------
+int RecordModel::rowCount(const QModelIndex& parent_) const
+{
+   return parent_.isValid() ? 0 : (int)m_ids.size();
+}
+
+//----------------------------------------------------------------------
+int RecordModel::columnCount(const QModelIndex& parent_) const
+{
+   return parent_.isValid() ? 0 : m_headers.size();
+}
+
+//----------------------------------------------------------------------
+QVariant RecordModel::data(const QModelIndex& index_, int role_) const
+{
+   if (!index_.isValid() || role_ != Qt::DisplayRole)
+      return QVariant();
+
+   const std::string& id = m_ids[index_.row()];
+
+   int column = field(index_.column());
+   if (column == PropertyStore::npos)
+      return QString::fromStdString(id);
+
+   const TSetValue* pValue = m_store.Get(m_store.Row(id), column);
+
+   return pValue ? model::ToString(*pValue) : QVariant();
+}
+
+//----------------------------------------------------------------------
+QVariant RecordModel::headerData(int section_, Qt::Orientation orientation_, int role_) const
+{
+   if (orientation_ == Qt::Horizontal && role_ == Qt::DisplayRole && section_ >= 0 && section_ < m_headers.size())
+      return m_headers.at(section_);
+
+   return QAbstractTableModel::headerData(section_, orientation_, role_);
+}
+
+//----------------------------------------------------------------------
+void RecordModel::sort(int column_, Qt::SortOrder order_)
+{
+   if (column_ < 0 || column_ >= columnCount())
+      return;
+
+   emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+   // Old row of each new one, the cells are looked up once
+   std::vector<int> order(m_ids.size());
+   std::iota(order.begin(), order.end(), 0);
+
+   int column = field(column_);
+
+   if (column == PropertyStore::npos)
+   {
+      auto by_id = [this](int left_, int right_) { return m_ids[left_] < m_ids[right_]; };
+
+      if (order_ == Qt::AscendingOrder)
+         std::stable_sort(order.begin(), order.end(), by_id);
+      else
+         std::stable_sort(order.begin(), order.end(), [&](int left_, int right_) { return by_id(right_, left_); });
+   }
+   else
+   {
+      std::vector<const TSetValue*> values(m_ids.size());
+
+      for (size_t row = 0; row < m_ids.size(); ++row)
+         values[row] = m_store.Get(m_store.Row(m_ids[row]), column);
+
+      if (order_ == Qt::AscendingOrder)
+         std::stable_sort(order.begin(), order.end(), [&](int left_, int right_) { return less(values[left_], values[right_]); });
+      else
+         std::stable_sort(order.begin(), order.end(), [&](int left_, int right_) { return less(values[right_], values[left_]); });
+   }
+
+   std::vector<std::string> ids(m_ids.size());
+   std::vector<int>         moved(m_ids.size());
+
+   for (size_t row = 0; row < order.size(); ++row)
+   {
+      ids[row] = std::move(m_ids[order[row]]);
+      moved[order[row]] = (int)row;
+   }
+
+   m_ids = std::move(ids);
+
+   reindex(0);
+
+   QModelIndexList from = persistentIndexList();
+   QModelIndexList to;
+   to.reserve(from.size());
+
+   for (const QModelIndex& index : from)
+      to.push_back(this->index(moved[index.row()], index.column()));
+
+   changePersistentIndexList(from, to);
+
+   emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+//----------------------------------------------------------------------
+int RecordModel::field(int column_) const
+{
+   return column_ >= 0 && (size_t)column_ < m_fields.size() ? m_fields[column_] : PropertyStore::npos;
+}
+
+//----------------------------------------------------------------------
+void RecordModel::addColumns(const std::vector<int>& rows_, bool insert_)
+{
+   // Properties set on any of the rows that have no column yet, in name order
+   QStringList          names;
+   std::vector<int>     fields;
+
+   for (const auto& [name, column] : m_store.Names())
+   {
+      QString header = QString::fromStdString(name);
+      if (m_columns.contains(header))
+         continue;
+
+      for (int row : rows_)
+      {
+         if (m_store.Get(row, column))
+         {
+            names .push_back(header);
+            fields.push_back(column);
+            break;
+         }
+      }
+   }
+
+   if (names.isEmpty())
+      return;
+
+   // Not signalled while the model is being reset
+   if (insert_)
+      beginInsertColumns(QModelIndex(), m_headers.size(), m_headers.size() + names.size() - 1);
+
+   for (int i = 0; i < names.size(); ++i)
+   {
+      m_columns.insert(names.at(i), m_headers.size());
+      m_headers.push_back(names.at(i));
+      m_fields .push_back(fields[i]);
+   }
+
+   if (insert_)
+      endInsertColumns();
+}
+
+//----------------------------------------------------------------------
+void RecordModel::removeRows(std::vector<int> rows_)
+{
+   if (rows_.empty())
+      return;
+
+   std::sort(rows_.begin(), rows_.end());
+   rows_.erase(std::unique(rows_.begin(), rows_.end()), rows_.end());
+
+   int first = rows_.front();
+   int last  = rows_.back();
+
+   // A single run is removed as such, scattered rows would cost a removal
+   // and a shift of the rows below per run, they reset the model instead
+   bool run = last - first + 1 == (int)rows_.size();
+
+   if (run)
+      beginRemoveRows(QModelIndex(), first, last);
+   else
+      beginResetModel();
+
+   // Compacted in one pass, the kept rows move up over the removed ones
+   size_t kept    = first;
+   size_t removed = 0;
+
+   for (size_t row = first; row < m_ids.size(); ++row)
+   {
+      if (removed < rows_.size() && rows_[removed] == (int)row)
+      {
+         m_rows.erase(m_ids[row]);
+         ++removed;
+         continue;
+      }
+
+      if (kept != row)
+         m_ids[kept] = std::move(m_ids[row]);
+
+      ++kept;
+   }
+
+   m_ids.resize(kept);
+
+   reindex(first);
+
+   if (run)
+      endRemoveRows();
+   else
+      endResetModel();
+}
+
+//----------------------------------------------------------------------
+void RecordModel::reindex(size_t from_)
+{
+   for (size_t row = from_; row < m_ids.size(); ++row)
+      m_rows[m_ids[row]] = (int)row;
+}
@@ -0,0 +1,60 @@
+#ifndef RECORDMODEL_H
+#define RECORDMODEL_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QStringList>
+
+#include "propertystore.h"
+
+// Nodes matching the filter, one row per node and a column per property.
+// Only the node ids are held, cells are read from the property store when
+// the view asks for them. Columns are the id followed by the properties in
+// name order, columns appearing later are appended so that the existing
+// ones keep their place.
+class RecordModel : public QAbstractTableModel
+{
+   Q_OBJECT
+
+public:
+   RecordModel(const PropertyStore& store_, QObject* pParent_ = nullptr);
+
+   void Clear();
+
+   // Rows of the nodes, in the order given until sorted
+   void Reset(const QStringList& ids_);
+
+   // Refreshes the rows of the shown nodes, adding the missing ones, and
+   // removes the rows of the hidden ones
+   void Update(const QStringList& shown_, const QStringList& hidden_);
+
+   int rowCount(const QModelIndex& parent_ = QModelIndex()) const override;
+   int columnCount(const QModelIndex& parent_ = QModelIndex()) const override;
+   QVariant data(const QModelIndex& index_, int role_ = Qt::DisplayRole) const override;
+   QVariant headerData(int section_, Qt::Orientation orientation_, int role_ = Qt::DisplayRole) const override;
+   void sort(int column_, Qt::SortOrder order_ = Qt::AscendingOrder) override;
+
+private:
+   // Store column of the model column, npos for the id
+   int field(int column_) const;
+
+   void addColumns(const std::vector<int>& rows_, bool insert_);
+   void removeRows(std::vector<int> rows_);
+   void reindex(size_t from_);
+
+   const PropertyStore&       m_store;
+
+   std::vector<std::string>   m_ids;
+   std::unordered_map<std::string, int>
+                              m_rows;
+
+   QStringList                m_headers;
+   std::vector<int>           m_fields;
+   QHash<QString, int>        m_columns;
+};
+
+#endif
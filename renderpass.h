@@ -0,0 +1,45 @@
+#ifndef RENDERPASS_H
+#define RENDERPASS_H
+
+#include <QGraphicsItem>
+
+#include "common.h"
+
+// SGraphicsView paints static items once into cached tiles and only the
+// items being moved (marked eLive) on every frame. Items consult the
+// current pass to paint in exactly one of the two.
+namespace render
+{
+   enum class EPass
+   {
+         eAll
+      ,  eStatic
+      ,  eLive
+   };
+
+   inline EPass pass = EPass::eAll;
+
+   // Labels and other children follow their parent
+   inline bool IsLive(const QGraphicsItem* pItem_)
+   {
+      for (; pItem_; pItem_ = pItem_->parentItem())
+      {
+         if (pItem_->data(eLive).toBool())
+            return true;
+      }
+
+      return false;
+   }
+
+   inline bool Paints(bool live_)
+   {
+      return pass == EPass::eAll || (pass == EPass::eLive) == live_;
+   }
+
+   inline bool Skip(const QGraphicsItem* pItem_)
+   {
+      return pass != EPass::eAll && !Paints(IsLive(pItem_));
+   }
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "saver.h"
+
+#include <QSaveFile>
+
+#include <unordered_map>
+
+#include "datfile.h"
+
+using namespace cat;
+
+// Arrows serialized between two progress notifications
+static const int     progress_step  = 4096;
+
+//----------------------------------------------------------------------
+Saver::Saver(std::shared_ptr<Node> pCategory_, const QString& path_, QObject* pParent_) :
+      QThread     (pParent_)
+   ,  m_pCategory (std::move(pCategory_))
+   ,  m_path      (path_)
+{
+}
+
+//----------------------------------------------------------------------
+Saver::~Saver()
+{
+   wait();
+}
+
+//----------------------------------------------------------------------
+bool Saver::Process()
+{
+   if (!m_pCategory)
+   {
+      m_error = tr("Nothing to save");
+      return false;
+   }
+
+   dat::Document doc;
+
+   for (const auto& node : m_pCategory->QueryNodes("*"))
+      doc.nodes.push_back(doc.Own(node.Name()));
+
+   Arrow::List arrows = m_pCategory->QueryArrows(Arrow("*", "*", "*").AsQuery());
+
+   // Querying the category copies the whole target node, the set node with
+   // every value in it, each target is copied once instead of per arrow
+   std::unordered_map<std::string, Node> targets;
+
+   const int total = (int)arrows.size();
+   int done {};
+
+   for (const auto& arrow : arrows)
+   {
+      if (++done % progress_step == 0)
+         emit progress(done, total);
+
+      // Skipping identity
+      if (arrow.Source() == arrow.Target())
+         continue;
+
+      dat::Arrow record;
+      record.name    = doc.Own(arrow.Name   ());
+      record.source  = doc.Own(arrow.Source ());
+      record.target  = doc.Own(arrow.Target ());
+
+      record.first_property = (uint32_t)doc.properties.size();
+
+      Arrow::List functions = arrow.QueryArrows(Arrow("*", "*", "*").AsQuery());
+
+      if (!functions.empty())
+      {
+         auto it = targets.find(arrow.Target());
+         if (it == targets.end())
+         {
+            Node::List nodes = m_pCategory->QueryNodes(arrow.Target());
+            if (!nodes.empty())
+               it = targets.emplace(arrow.Target(), std::move(nodes.front())).first;
+         }
+
+         if (it != targets.end())
+         {
+            for (const auto& function : functions)
+            {
+               auto values = it->second.QueryNodes(function.Target());
+               if (!values.empty())
+                  doc.properties.push_back(dat::FromValue(Function(function.Name(), values.front().GetValue()), doc));
+            }
+         }
+      }
+
+      record.property_count = (uint32_t)doc.properties.size() - record.first_property;
+
+      doc.arrows.push_back(record);
+   }
+
+   std::string buffer;
+
+   if (!dat::Write(doc, buffer))
+   {
+      m_error = tr("The model exceeds the limits of the .dat format");
+      return false;
+   }
+
+   QSaveFile file(m_path);
+
+   if (!file.open(QIODevice::WriteOnly))
+   {
+      m_error = file.errorString();
+      return false;
+   }
+
+   if (file.write(buffer.data(), (qint64)buffer.size()) != (qint64)buffer.size() || !file.commit())
+   {
+      m_error = file.errorString();
+      return false;
+   }
+
+   emit progress(total, total);
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+QString Saver::Path() const
+{
+   return m_path;
+}
+
+//----------------------------------------------------------------------
+QString Saver::Error() const
+{
+   return m_error;
+}
+
+//----------------------------------------------------------------------
+bool Saver::Succeeded() const
+{
+   return m_succeeded;
+}
+
+//----------------------------------------------------------------------
+void Saver::run()
+{
+   m_succeeded = Process();
+
+   emit saved(m_succeeded);
+}
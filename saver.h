@@ -0,0 +1,44 @@
+#ifndef SAVER_H
+#define SAVER_H
+
+#include <memory>
+
+#include <QThread>
+
+#include "node.h"
+
+// Serializes a category to a .dat file off the GUI thread. The category is
+// only read, the scene shares it and moves to a copy before its next edit.
+// The file is written to a temporary and renamed over the target once
+// complete, a failed save leaves the previous file untouched.
+class Saver : public QThread
+{
+   Q_OBJECT
+
+public:
+   Saver(std::shared_ptr<cat::Node> pCategory_, const QString& path_, QObject* pParent_ = nullptr);
+   ~Saver();
+
+   bool Process();
+
+   QString Path() const;
+   QString Error() const;
+
+   // Result of the save run on the thread, once it has finished
+   bool Succeeded() const;
+
+signals:
+   void progress(int done_, int total_);
+   void saved(bool ok_);
+
+protected:
+   void run() override;
+
+private:
+   std::shared_ptr<cat::Node> m_pCategory;
+   QString                    m_path;
+   QString                    m_error;
+   bool                       m_succeeded {};
+};
+
+#endif
@@ -1,34 +1,33 @@
 #include "scene.h"
 
 #include <QGraphicsView>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QInputDialog>
 #include <QMessageBox>
-#include <QUuid>
 #include <QGraphicsSceneMouseEvent>
 #include <QMenu>
 #include <QAction>
 #include <QDebug>
+#include <QGraphicsSceneHelpEvent>
+#include <QToolTip>
+#include <QSignalBlocker>
 
-#include <type_traits>
 #include <assert.h>
-#include <fstream>
 #include <sstream>
 #include <iostream>
 
+#include "cedgelayer.h"
 #include "common.h"
-#include "tokenizer.h"
-#include "parser.h"
-#include "../Cat/test/test.h"
-
-static const char* x_token       = "x_";
-static const char* y_token       = "y_";
-static const char* id_token      = "id_";
-
-static const char* sSet          = "set";
-
-static const char* sVoid         = "void";
+#include "loader.h"
+#include "filterprogram.h"
+#include "model.h"
+#include "parallel.h"
+#include "saver.h"
+#include "undohistory.h"
 
 using namespace cat;
+using namespace model;
 
 //----------------------------------------------------------------------
 static std::string toID(const QGraphicsItem* const pItem_)
@@ -36,60 +35,39 @@ static std::string toID(const QGraphicsItem* const pItem_)
    return pItem_->data(eID).toString().toStdString();
 }
 
-//----------------------------------------------------------------------
-static std::string rnd_uuid()
-{
-   QString ret = QUuid::createUuid().toString();
-
-   return "n" + ret.replace('-','_').mid(1, 36).toStdString();
-}
-
-//----------------------------------------------------------------------
-static std::list<Function> function_values(const std::string& source_, const std::string& target_, std::shared_ptr<cat::Node> pNode_)
-{
-   auto target = pNode_->QueryNodes(target_);
-   if (target.empty())
-      return std::list<Function>();
+// Time budget of one progressive loading step
+static const int     load_slice_ms     = 8;
 
-   Arrow::List morphisms = pNode_->QueryArrows(Arrow(source_, target_, "*").AsQuery());
-   if (morphisms.empty())
-      return std::list<Function>();
+// Interval at which layout positions are pulled into the scene
+static const int     layout_interval_ms = 33;
 
-   std::list<Function> fns;
-
-   for (const auto& function : morphisms.front().QueryArrows(Arrow("*", "*", "*").AsQuery()))
-   {
-      auto vals = target.front().QueryNodes(function.Target());
-      if (!vals.empty())
-         fns.emplace_back(function.Name(), vals.front().GetValue());
-   }
+// Estimated memory the undo and redo entries may hold together
+static const size_t  undo_budget_bytes  = 64 << 20;
 
-   return fns;
-}
+// Journal size from which it is folded into its base file
+static const qint64  journal_compact_bytes = 4 << 20;
 
 //----------------------------------------------------------------------
-Scene::Scene()
+Scene::Scene() :
+   m_History(undo_budget_bytes)
 {
-   test();
-
    Init();
 
-   m_pMnu = new QMenu(NULL);
-
-   m_pAddProp     = m_pMnu->addAction(tr("Add property"));
-   m_pClone       = m_pMnu->addAction(tr("Clone"));
-   m_pCreateArrow = m_pMnu->addAction(tr("Create arrow"));
-   m_pDeleteArrow = m_pMnu->addAction(tr("Delete arrows"));
+   connect(this, SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
 
-   connect(m_pMnu, SIGNAL(triggered(QAction*)), SLOT(slotActivated(QAction*)));
+   m_pLoadTimer = new QTimer(this);
+   connect(m_pLoadTimer, &QTimer::timeout, this, &Scene::loadStep);
 
-   connect(this, SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
+   m_pLayoutTimer = new QTimer(this);
+   connect(m_pLayoutTimer, &QTimer::timeout, this, &Scene::applyLayout);
 }
 
 //----------------------------------------------------------------------
 Scene::~Scene()
 {
    DeInit();
+
+   delete m_pMnu;
 }
 
 //----------------------------------------------------------------------
@@ -102,19 +80,44 @@ void Scene::Init()
 
    setSceneRect(0, 0, scene_size, scene_size);
 
+   if (m_BatchedEdges && !m_pEdgeLayer)
+   {
+      m_pEdgeLayer = new CEdgeLayer;
+      addItem(m_pEdgeLayer);
+   }
+
    emit updateStatistics(Statistics());
 }
 
 //----------------------------------------------------------------------
 void Scene::DeInit()
 {
-   if (!m_pLCategory)
+   CancelLoad();
+   StopLayout();
+   waitSave();
+
+   if (!m_pLCategory && m_Items.isEmpty())
       return;
 
+   emit documentClosed();
+
    m_pSource = nullptr;
 
    m_pLCategory = nullptr;
 
+   m_Items.clear();
+   m_Moved.clear();
+   m_Selected.clear();
+   m_Properties.Clear();
+   m_pFilter.reset();
+   m_Journal.Close();
+
+   m_History.Clear();
+   emit historyChanged();
+
+   // Deleted by clear() together with the other items
+   m_pEdgeLayer = nullptr;
+
    clear();
 
    emit updateStatistics(Statistics());
@@ -123,60 +126,145 @@ void Scene::DeInit()
 //----------------------------------------------------------------------
 bool Scene::AddProperty2Node(QGraphicsItem* pItem_, const Function& property_)
 {
-   if (!pItem_)
-      pItem_ = m_pSource;
+   if (pItem_)
+      return SetProperties({ { pItem_, { property_ } } });
 
-   if (!pItem_ || !m_pLCategory)
-      return false;
+   PropertyEdits edits;
+   edits.reserve(m_Selected.size());
+
+   for (QGraphicsItem* pItem : selection())
+      edits.push_back({ pItem, { property_ } });
 
-   const auto& [fn_name, fn_value] = property_;
+   return SetProperties(edits);
+}
+
+//----------------------------------------------------------------------
+bool Scene::SetProperties(const PropertyEdits& edits_)
+{
+   if (!m_pLCategory || edits_.empty())
+      return false;
 
-   auto name = toID(pItem_);
+   detach();
 
-   Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(name, sSet, "*").AsQuery());
-   if (arrows.empty())
+   Node::List sets = m_pLCategory->QueryNodes(sSet);
+   if (sets.empty())
       return false;
 
-   Arrow& arrow = arrows.front();
+   // All value nodes go into one copy of the set node, replaced once before
+   // the updated arrows are added back
+   Node& set = sets.front();
 
-   m_pLCategory->EraseArrow(arrow.Name());
+   std::vector<Arrow>   updated;
+   std::vector<CNode*>  nodes;
 
-   auto target_set = rnd_uuid();
+   // Previous values, or their removal when the node had none
+   std::vector<Journal::Record> inverse;
 
-   arrow.AddArrow(Arrow(sVoid, target_set, fn_name));
+   bool label        {};
+   bool reevaluate   {};
+   bool current      {};
 
+   for (const auto& [pItem, properties] : edits_)
    {
-      Node::List nodes = m_pLCategory->QueryNodes(name);
-      if (!nodes.empty())
+      if (!pItem || properties.empty())
+         continue;
+
+      auto name = toID(pItem);
+
+      Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(name, sSet, "*").AsQuery());
+      if (arrows.empty())
+         continue;
+
+      Arrow& arrow = arrows.front();
+
+      m_pLCategory->EraseArrow(arrow.Name());
+
+      int row = m_Properties.Insert(name);
+
+      if (!m_Replaying)
       {
-         auto& source = nodes.front();
+         std::list<Function> previous;
 
-         source.AddNode(Node(sVoid, Node::EType::eSet));
+         for (const auto& property : properties)
+         {
+            if (const TSetValue* pVal = m_Properties.Get(row, property.first))
+               previous.emplace_back(property.first, *pVal);
+            else
+               inverse.push_back({ Journal::ERecord::eRemoveProperty, { name, property.first } });
+         }
 
-         m_pLCategory->ReplaceNode(source);
+         if (!previous.empty())
+            inverse.push_back({ Journal::ERecord::eSetProperties, { name }, QPointF(), std::move(previous) });
       }
-   }
 
-   {
-      Node::List nodes = m_pLCategory->QueryNodes(sSet);
-      if (!nodes.empty())
+      for (const auto& [fn_name, fn_value] : properties)
       {
-         auto target = nodes.front();
+         m_Properties.Set(row, fn_name, fn_value);
+
+         Arrow::List functions = arrow.QueryArrows(Arrow("*", "*", fn_name).AsQuery());
+         if (!functions.empty())
+         {
+            set.EraseNode(functions.front().Target());
+            arrow.EraseArrow(fn_name);
+         }
+
+         auto target_set = UniqueName();
+
+         arrow.AddArrow(Arrow(sVoid, target_set, fn_name));
 
          Node node = Node(target_set, Node::EType::eSet);
          node.SetValue(fn_value);
 
-         target.AddNode(node);
+         set.AddNode(node);
+
+         label       |= fn_name == m_ShownName;
+         reevaluate  |= isFiltered(fn_name);
+      }
+
+      {
+         Node::List sources = m_pLCategory->QueryNodes(name);
+         if (!sources.empty() && sources.front().QueryNodes(sVoid).empty())
+         {
+            auto& source = sources.front();
+
+            source.AddNode(Node(sVoid, Node::EType::eSet));
+
+            m_pLCategory->ReplaceNode(source);
+         }
+      }
+
+      updated.push_back(arrow);
+
+      journal({ Journal::ERecord::eSetProperties, { name }, QPointF(), properties });
+
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+      {
+         nodes.push_back(pNode);
 
-         m_pLCategory->ReplaceNode(target);
+         current |= m_Selected.contains(pNode);
       }
    }
 
-   m_pLCategory->AddArrow(arrow);
+   if (updated.empty())
+      return false;
+
+   m_pLCategory->ReplaceNode(set);
+
+   for (const Arrow& arrow : updated)
+      m_pLCategory->AddArrow(arrow);
+
+   history(tr("Set properties"), std::move(inverse));
 
-   emit updateNodeData(function_values(name, sSet, m_pLCategory));
+   if (label)
+   {
+      for (CNode* pNode : nodes)
+         changeLabel(pNode);
+   }
 
-   changeLabel(pItem_);
+   if (current)
+      publishSelection();
+
+   refilter(nodes, reevaluate);
 
    return true;
 }
@@ -184,60 +272,128 @@ bool Scene::AddProperty2Node(QGraphicsItem* pItem_, const Function& property_)
 //----------------------------------------------------------------------
 void Scene::RemovePropertyFromNode(QGraphicsItem* pItem_, const cat::FunctionName& name_)
 {
-   if (!pItem_)
-      pItem_ = m_pSource;
+   if (pItem_)
+      RemoveProperty({ pItem_ }, name_);
+   else
+      RemoveProperty(selection(), name_);
+}
 
-   if (!pItem_ || !m_pLCategory)
+//----------------------------------------------------------------------
+void Scene::RemoveProperty(const std::vector<QGraphicsItem*>& items_, const cat::FunctionName& name_)
+{
+   if (!m_pLCategory || items_.empty())
       return;
 
-   Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(toID(pItem_), sSet, "*").AsQuery());
-   if (arrows.empty())
+   detach();
+
+   Node::List sets = m_pLCategory->QueryNodes(sSet);
+   if (sets.empty())
       return;
 
-   Arrow& arrow = arrows.front();
+   // The value nodes are erased from one copy of the set node, replaced once
+   Node& set = sets.front();
 
-   m_pLCategory->EraseArrow(arrow.Name());
+   std::vector<CNode*>  nodes;
+   std::vector<Journal::Record> inverse;
 
-   Arrow::List functions = arrow.QueryArrows(Arrow("*", "*", name_).AsQuery());
-   if (functions.empty())
-      return;
+   bool erased    {};
+   bool current   {};
 
-   arrow.EraseArrow(name_);
+   for (QGraphicsItem* pItem : items_)
+   {
+      if (!pItem)
+         continue;
 
-   m_pLCategory->AddArrow(arrow);
+      auto name = toID(pItem);
+
+      Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(name, sSet, "*").AsQuery());
+      if (arrows.empty())
+         continue;
+
+      Arrow& arrow = arrows.front();
+
+      Arrow::List functions = arrow.QueryArrows(Arrow("*", "*", name_).AsQuery());
+      if (functions.empty())
+         continue;
+
+      m_pLCategory->EraseArrow(arrow.Name());
+
+      arrow.EraseArrow(name_);
+
+      m_pLCategory->AddArrow(arrow);
 
-   {
-      Node::List nodes = m_pLCategory->QueryNodes(arrow.Source());
-      if (!nodes.empty())
       {
-         auto& source = nodes.front();
+         Node::List sources = m_pLCategory->QueryNodes(arrow.Source());
+         if (!sources.empty())
+         {
+            auto& source = sources.front();
 
-         source.EraseNode(functions.front().Source());
+            source.EraseNode(functions.front().Source());
 
-         m_pLCategory->ReplaceNode(source);
+            m_pLCategory->ReplaceNode(source);
+         }
       }
-   }
 
-   {
-      Node::List nodes = m_pLCategory->QueryNodes(arrow.Target());
-      if (!nodes.empty())
-      {
-         auto target = nodes.front();
+      set.EraseNode(functions.front().Target());
+      erased = true;
+
+      int row = m_Properties.Row(name);
+
+      if (const TSetValue* pVal = m_Properties.Get(row, name_))
+         inverse.push_back({ Journal::ERecord::eSetProperties, { name }, QPointF(), { { name_, *pVal } } });
 
-         target.EraseNode(functions.front().Target());
+      m_Properties.Remove(row, name_);
 
-         m_pLCategory->ReplaceNode(target);
+      journal({ Journal::ERecord::eRemoveProperty, { name, name_ } });
+
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+      {
+         nodes.push_back(pNode);
+
+         current |= m_Selected.contains(pNode);
       }
    }
 
-   emit updateNodeData(function_values(toID(pItem_), sSet, m_pLCategory));
+   if (!erased)
+      return;
+
+   m_pLCategory->ReplaceNode(set);
+
+   history(tr("Remove property"), std::move(inverse));
+
+   if (current)
+      publishSelection();
+
+   refilter(nodes, isFiltered(name_));
 }
 
 //----------------------------------------------------------------------
 void Scene::OnContextMenu()
 {
-   if (m_pSource)
-      m_pMnu->exec(QCursor::pos());
+   if (!m_pSource)
+      return;
+
+   createMenu();
+
+   m_pMnu->exec(QCursor::pos());
+}
+
+//----------------------------------------------------------------------
+void Scene::createMenu()
+{
+   // Built on first use, nothing of it is needed to show the window
+   if (m_pMnu)
+      return;
+
+   m_pMnu = new QMenu(NULL);
+
+   m_pAddProp     = m_pMnu->addAction(tr("Add property"));
+   m_pClone       = m_pMnu->addAction(tr("Clone"));
+   m_pCloneInternal = m_pMnu->addAction(tr("Clone with internal arrows only"));
+   m_pCreateArrow = m_pMnu->addAction(tr("Create arrow"));
+   m_pDeleteArrow = m_pMnu->addAction(tr("Delete arrows"));
+
+   connect(m_pMnu, SIGNAL(triggered(QAction*)), SLOT(slotActivated(QAction*)));
 }
 
 //----------------------------------------------------------------------
@@ -247,8 +403,21 @@ QString Scene::Statistics()
       return "";
 
    return tr("Stat: ") +
-      QString::number(m_pLCategory->CountNodes()) + tr(" nodes, ") +
-      QString::number(m_pLCategory->CountArrows() - m_pLCategory->CountNodes()) + tr(" arrows");
+      QString::number(CountNodes()) + tr(" nodes, ") +
+      QString::number(CountArrows()) + tr(" arrows");
+}
+
+//----------------------------------------------------------------------
+int Scene::CountNodes() const
+{
+   return m_pLCategory ? (int)m_pLCategory->CountNodes() : 0;
+}
+
+//----------------------------------------------------------------------
+int Scene::CountArrows() const
+{
+   // Identity arrows are not counted
+   return m_pLCategory ? (int)(m_pLCategory->CountArrows() - m_pLCategory->CountNodes()) : 0;
 }
 
 //----------------------------------------------------------------------
@@ -270,6 +439,8 @@ void Scene::mouseReleaseEvent(QGraphicsSceneMouseEvent* pEvent_)
 {
    QGraphicsScene::mouseReleaseEvent(pEvent_);
 
+   commitMoved();
+
    if (pEvent_->button() == Qt::RightButton)
       OnContextMenu();
 }
@@ -282,9 +453,7 @@ void Scene::mouseDoubleClickEvent(QGraphicsSceneMouseEvent* pEvent_)
    if (!m_pLCategory)
       return;
 
-   auto selected = selectedItems();
-
-   if (selected.size() != 1)
+   if (m_Selected.size() != 1)
    {
       bool answer {};
       auto node_name = QInputDialog::getText(NULL, tr("Create node"), tr("Node name"), QLineEdit::Normal, tr(""), &answer);
@@ -292,7 +461,7 @@ void Scene::mouseDoubleClickEvent(QGraphicsSceneMouseEvent* pEvent_)
          return;
 
       if (node_name.isEmpty())
-         node_name = rnd_uuid().c_str();
+         node_name = UniqueName().c_str();
 
       createNode(node_name, pEvent_->scenePos());
 
@@ -302,16 +471,7 @@ void Scene::mouseDoubleClickEvent(QGraphicsSceneMouseEvent* pEvent_)
    {
       if (QMessageBox::question(NULL, tr("Delete node?"), tr("Are you sure?"), QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes)
       {
-         if (m_pLCategory->EraseNode(toID(selected.front())))
-         {
-            auto item = selected.front();
-
-            static_cast<CNode*>(item)->DeInit();
-            removeItem(item);
-            delete item;
-
-            emit updateStatistics(Statistics());
-         }
+         eraseNode(*m_Selected.begin());
       }
    }
 }
@@ -322,27 +482,38 @@ void Scene::dragMoveEvent(QGraphicsSceneDragDropEvent* pEvent_)
    QGraphicsScene::dragMoveEvent(pEvent_);
 }
 
+//----------------------------------------------------------------------
+void Scene::helpEvent(QGraphicsSceneHelpEvent* pEvent_)
+{
+   // Batched arrows are not items, their names are looked up in the layer
+   if (m_pEdgeLayer && !itemAt(pEvent_->scenePos(), QTransform()))
+   {
+      int edge = m_pEdgeLayer->EdgeAt(pEvent_->scenePos(), arrow_pick_width);
+      if (edge != CEdgeLayer::npos)
+      {
+         QToolTip::showText(pEvent_->screenPos(), m_pEdgeLayer->Name(edge), pEvent_->widget());
+         pEvent_->accept();
+         return;
+      }
+   }
+
+   QGraphicsScene::helpEvent(pEvent_);
+}
+
 //----------------------------------------------------------------------
 void Scene::selectionChanged()
 {
    if (!m_pLCategory)
       return;
 
-   auto items = selectedItems();
-
-   if (items.empty())
-   {
-      m_pSource = nullptr;
-
-      emit updateNodeData(std::list<Function>());
-   }
+   // Kept up to date by the nodes, no list of the selected items is built.
+   // The source stays the node selected first while it is selected.
+   CNode* pSource = dynamic_cast<CNode*>(m_pSource);
 
-   if (items.size() == 1)
-   {
-      m_pSource = items.at(0);
+   if (!pSource || !m_Selected.contains(pSource))
+      m_pSource = m_Selected.empty() ? nullptr : *m_Selected.begin();
 
-      emit updateNodeData(function_values(toID(m_pSource), sSet, m_pLCategory));
-   }
+   publishSelection();
 }
 
 //----------------------------------------------------------------------
@@ -363,116 +534,75 @@ void Scene::slotActivated(QAction* pAction_)
       {
          auto value = QInputDialog::getText(NULL, tr("Property value"), tr("Value"));
          cat::Function prop(name.toStdString(), value.toStdString());
-         AddProperty2Node(m_pSource, prop);
+         AddProperty2Node(nullptr, prop);
       }
       else if (type == cat_types.at((int)cat::ESetTypes::eInt))
       {
          auto value = QInputDialog::getInt(NULL, tr("Property value"), tr("Value"));
          cat::Function prop(name.toStdString(), int(value));
-         AddProperty2Node(m_pSource, prop);
+         AddProperty2Node(nullptr, prop);
       }
       else if (type == cat_types.at((int)cat::ESetTypes::eDouble))
       {
          auto value = QInputDialog::getDouble(NULL, tr("Property value"), tr("Value"));
          cat::Function prop(name.toStdString(), double(value));
-         AddProperty2Node(m_pSource, prop);
+         AddProperty2Node(nullptr, prop);
       }
       else if (type == cat_types.at((int)cat::ESetTypes::eFloat))
       {
          auto value = QInputDialog::getDouble(NULL, tr("Property value"), tr("Value"));
          cat::Function prop(name.toStdString(), float(value));
-         AddProperty2Node(m_pSource, prop);
+         AddProperty2Node(nullptr, prop);
       }
 
       if (name == x_token || name == y_token)
-         positionChanged(static_cast<CNode*>(m_pSource));
+         commitPositions(std::vector<CNode*>(m_Selected.begin(), m_Selected.end()));
    }
-   else if (pAction_ == m_pClone && m_pSource && m_pLCategory)
+   else if ((pAction_ == m_pClone || pAction_ == m_pCloneInternal) && m_pSource && m_pLCategory)
    {
-      auto old_name = toID    (m_pSource);
-      auto new_name = rnd_uuid();
-
-      m_pLCategory->CloneNode(old_name, new_name);
+      // The source node goes to the mouse, the others keep their place
+      // relative to it
+      std::vector<CNode*> nodes = m_Selected.isEmpty() ?
+         std::vector<CNode*>{ static_cast<CNode*>(m_pSource) } :
+         std::vector<CNode*>(m_Selected.begin(), m_Selected.end());
 
-      CNode* pNewNode = new CNode(m_LastMousePos.x(), m_LastMousePos.y(), new_name.c_str());
-      addItem(pNewNode);
+      std::vector<CNode*> copies = cloneNodes(nodes, m_LastMousePos - m_pSource->pos(), pAction_ == m_pClone);
 
-      connect(pNewNode, &CNode::positionChanged, this, &Scene::positionChanged);
+      // The copies are selected, ready to be dragged apart
+      QSet<CNode*> copied;
+      for (CNode* pCopy : copies)
+         copied.insert(pCopy);
 
-      emit updateStatistics(Statistics());
-
-      // outward
-      {
-         Arrow::List new_arrows = m_pLCategory->QueryArrows(Arrow(new_name, "*", "*").AsQuery());
-
-         for (Arrow& arrow : new_arrows)
-         {
-            if (arrow.Source() == arrow.Target())
-               continue;
-
-            QGraphicsItem* pTargetNode = getItem(arrow.Target().c_str());
-
-            CArrow* pItem = new CArrow(pNewNode, (CNode*)pTargetNode, arrow.Name().c_str());
-            addItem(pItem);
-         }
-      }
-
-      // inward
-      {
-         Arrow::List new_arrows = m_pLCategory->QueryArrows(Arrow("*", new_name, "*").AsQuery());
-
-         for (Arrow& arrow : new_arrows)
-         {
-            if (arrow.Source() == arrow.Target())
-               continue;
-
-            QGraphicsItem* pSourceNode = getItem(arrow.Source().c_str());
+      nodes.insert(nodes.end(), copies.begin(), copies.end());
 
-            CArrow* pItem = new CArrow((CNode*)pSourceNode, pNewNode, arrow.Name().c_str());
-            addItem(pItem);
-         }
-      }
+      applySelection(nodes, [&](CNode* pNode_) { return copied.contains(pNode_); });
    }
-   else if (pAction_ == m_pDeleteArrow && m_pSource && selectedItems().size() == 2 && m_pLCategory)
+   else if (pAction_ == m_pDeleteArrow && m_pSource && m_Selected.size() == 2 && m_pLCategory)
    {
-      auto sitems = selectedItems();
-
-      CNode* source = static_cast<CNode*>(sitems.at(0));
-      CNode* target = static_cast<CNode*>(sitems.at(1));
+      CNode* source = *m_Selected.begin();
+      CNode* target = *std::next(m_Selected.begin());
 
       if (m_pSource != source)
          std::swap(source, target);
 
-      Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(toID(source), toID(target), "*").AsQuery());
-      if (!arrows.empty())
-      {
-         for (const auto& it : arrows)
-         {
-            if (m_pLCategory->EraseArrow(it.Name()))
-            {
-               if (CArrow* pNode = (CArrow*)getItem(it.Name().c_str()))
-               {
-                  removeItem(pNode);
-                  ((CArrow*)pNode)->DeInit();
-                  delete pNode;
-               }
-            }
-         }
-      }
+      m_History.Begin(tr("Delete arrows"));
+
+      for (const Arrow& arrow : m_pLCategory->QueryArrows(Arrow(toID(source), toID(target), "*").AsQuery()))
+         eraseArrow(arrow);
+
+      m_History.End();
 
       emit updateStatistics(Statistics());
    }
-   else if (pAction_ == m_pCreateArrow && m_pSource && selectedItems().size() == 2)
+   else if (pAction_ == m_pCreateArrow && m_pSource && m_Selected.size() == 2)
    {
       bool ok{};
       auto arrow_name = QInputDialog::getText(NULL, tr("Create arrow"), tr("Arrow name"), QLineEdit::Normal, "", &ok);
 
       if (ok)
       {
-         auto items = selectedItems();
-
-         CNode* source = static_cast<CNode*>(items.at(0));
-         CNode* target = static_cast<CNode*>(items.at(1));
+         CNode* source = *m_Selected.begin();
+         CNode* target = *std::next(m_Selected.begin());
 
          if (m_pSource != source)
             std::swap(source, target);
@@ -482,124 +612,443 @@ void Scene::slotActivated(QAction* pAction_)
          emit updateStatistics(Statistics());
       }
 
-      emit updateNodeData(std::list<cat::Function>());
+      emit updateNodeData(std::list<cat::Function>(), std::set<cat::FunctionName>());
    }
 }
 
 //----------------------------------------------------------------------
-void Scene::positionChanged(const CNode* pNode_)
+CNode* Scene::cloneNode(CNode* pNode_, const std::string& name_, const QPointF& pos_)
 {
-   if (!m_pLCategory)
-      return;
+   auto old_name = toID(pNode_);
+   auto new_name = name_;
+
+   detach();
+
+   m_pLCategory->CloneNode(old_name, new_name);
 
-   std::list<Function> fns = function_values(toID(pNode_), sSet, m_pLCategory);
+   CNode* pNewNode = addNodeItem(new_name.c_str(), pos_);
 
-   for (Function& fn : fns)
+   if (m_Properties.Row(old_name) != PropertyStore::npos)
+      m_Properties.Assign(m_Properties.Insert(new_name), FunctionValues(new_name, sSet, *m_pLCategory));
+
+   refilter({ pNewNode }, m_pFilter != nullptr);
+
+   emit updateStatistics(Statistics());
+
+   // outward
    {
-      if (fn.first == x_token)
-      {
-         fn.second = (int)pNode_->pos().x();
-         RemovePropertyFromNode((QGraphicsItem*)pNode_, fn.first);
-         AddProperty2Node((QGraphicsItem*)pNode_, fn);
-      }
+      Arrow::List new_arrows = m_pLCategory->QueryArrows(Arrow(new_name, "*", "*").AsQuery());
 
-      if (fn.first == y_token)
+      for (Arrow& arrow : new_arrows)
       {
-         fn.second = (int)pNode_->pos().y();
-         RemovePropertyFromNode((QGraphicsItem*)pNode_, fn.first);
-         AddProperty2Node((QGraphicsItem*)pNode_, fn);
+         if (arrow.Source() == arrow.Target())
+            continue;
+
+         QGraphicsItem* pTargetNode = getItem(arrow.Target().c_str());
+
+         addArrowItem(pNewNode, (CNode*)pTargetNode, arrow.Name().c_str());
       }
    }
-}
 
-//----------------------------------------------------------------------
-CNode* Scene::createNode(const QString& name_, const QPointF& pos_)
-{
-   if (!m_pLCategory)
-      return nullptr;
+   // inward
+   {
+      Arrow::List new_arrows = m_pLCategory->QueryArrows(Arrow("*", new_name, "*").AsQuery());
 
-   if (!m_pLCategory->AddNode(Node(name_.toStdString(), Node::EType::eObject)))
-      return nullptr;
+      for (Arrow& arrow : new_arrows)
+      {
+         if (arrow.Source() == arrow.Target())
+            continue;
 
-   CNode* pItem = new CNode(pos_.x(), pos_.y(), name_);
-   addItem(pItem);
+         QGraphicsItem* pSourceNode = getItem(arrow.Source().c_str());
 
-   connect(pItem, &CNode::positionChanged, this, &Scene::positionChanged);
+         addArrowItem((CNode*)pSourceNode, pNewNode, arrow.Name().c_str());
+      }
+   }
 
-   return pItem;
+   journal({ Journal::ERecord::eCloneNode, { old_name, new_name }, pos_ });
+
+   history(tr("Clone node"), { { Journal::ERecord::eEraseNode, { new_name } } });
+
+   return pNewNode;
 }
 
 //----------------------------------------------------------------------
-CNode* Scene::createNode(const cat::Node& node_, const QPointF& pos_)
+std::vector<CNode*> Scene::cloneNodes(const std::vector<CNode*>& nodes_, const QPointF& offset_, bool boundary_)
 {
-   if (!m_pLCategory)
-      return nullptr;
+   std::vector<CNode*> copies;
 
-   if (!m_pLCategory->AddNode(node_))
-      return nullptr;
+   if (!m_pLCategory || nodes_.empty())
+      return copies;
 
-   CNode* pItem = new CNode(pos_.x(), pos_.y(), node_.Name().c_str());
-   addItem(pItem);
+   detach();
 
-   connect(pItem, &CNode::positionChanged, this, &Scene::positionChanged);
+   // The set node holds the values, its arrows are the properties
+   CNode* pSet = dynamic_cast<CNode*>(getItem(sSet));
 
-   return pItem;
-}
+   // Original -> copy, arrows between originals are remapped through it
+   QHash<CNode*, CNode*> copy;
+   copy.reserve((int)nodes_.size());
 
-//----------------------------------------------------------------------
-CArrow* Scene::createArrow(CNode* pSource_, CNode* pTarget_, const QString& name_, std::list<cat::Function> pFns_)
-{
-   if (!m_pLCategory)
-      return nullptr;
+   m_History.Begin(tr("Clone nodes"));
 
-   auto source_name = pSource_->data(eID).toString();
-   auto target_name = pTarget_->data(eID).toString();
+   for (CNode* pNode : nodes_)
+   {
+      if (pNode == pSet || copy.contains(pNode))
+         continue;
 
-   Arrow arrow = name_.isEmpty() ?
-      Arrow(source_name.toStdString(), target_name.toStdString()) :
-      Arrow(source_name.toStdString(), target_name.toStdString(), name_.toStdString());
+      CNode* pCopy = createNode(UniqueName().c_str(), pNode->pos() + offset_);
+      if (!pCopy)
+         continue;
 
-   Node::List nodes = m_pLCategory->QueryNodes(target_name.toStdString());
-   if (nodes.empty())
-      return nullptr;
+      copy.insert(pNode, pCopy);
+      copies.push_back(pCopy);
+   }
 
-   for (const auto& it : pFns_)
+   // Properties are read from the store and go into one copy of the set
+   // node, as SetProperties does
+   if (pSet)
    {
-      auto target_set = rnd_uuid();
+      Node::List sets = m_pLCategory->QueryNodes(sSet);
 
-      arrow.AddArrow(Arrow(sVoid, target_set, it.first));
+      std::vector<std::pair<Arrow, std::list<Function>>> arrows;
 
-      if (!nodes.empty())
+      for (auto it = copy.cbegin(); it != copy.cend() && !sets.empty(); ++it)
       {
-         Node node = Node(target_set, Node::EType::eSet);
-         node.SetValue(it.second);
+         int row = m_Properties.Row(toID(it.key()));
+         if (row == PropertyStore::npos)
+            continue;
 
-         nodes.front().AddNode(node);
-      }
-   }
+         std::list<Function> fns = m_Properties.Values(row);
 
-   m_pLCategory->ReplaceNode(nodes.front());
+         // The stored position is the copy's, not the original's
+         for (auto& [fn_name, fn_value] : fns)
+         {
+            if (fn_name == x_token)
+               fn_value = (int)it.value()->pos().x();
+            else if (fn_name == y_token)
+               fn_value = (int)it.value()->pos().y();
+         }
 
-   if (!m_pLCategory->AddArrow(arrow))
-      return nullptr;
+         Arrow arrow(toID(it.value()), sSet);
 
-   CArrow* pItem = new CArrow(pSource_, pTarget_, arrow.Name().c_str());
-   addItem(pItem);
+         for (const auto& [fn_name, fn_value] : fns)
+         {
+            auto target_set = UniqueName();
 
-   return pItem;
-}
+            arrow.AddArrow(Arrow(sVoid, target_set, fn_name));
 
-//----------------------------------------------------------------------
-QGraphicsItem* Scene::getItem(const QString& name_) const
+            Node node = Node(target_set, Node::EType::eSet);
+            node.SetValue(fn_value);
+
+            sets.front().AddNode(node);
+         }
+
+         arrows.emplace_back(std::move(arrow), std::move(fns));
+      }
+
+      if (!arrows.empty())
+         m_pLCategory->ReplaceNode(sets.front());
+
+      for (auto& [arrow, fns] : arrows)
+      {
+         if (!m_pLCategory->AddArrow(arrow))
+            continue;
+
+         m_Properties.Assign(m_Properties.Insert(arrow.Source()), fns);
+
+         addArrowItem(static_cast<CNode*>(getItem(arrow.Source().c_str())), pSet, arrow.Name().c_str());
+
+         journal({ Journal::ERecord::eAddArrow, { arrow.Name(), arrow.Source(), arrow.Target() }, QPointF(), fns });
+
+         history(tr("Create arrow"), { { Journal::ERecord::eEraseArrow, { arrow.Name() } } });
+      }
+   }
+
+   // The arrows come from the items' adjacency, no arrow of the category
+   // outside the cloned nodes is visited
+   struct Link
+   {
+      CNode*   pSource  {};
+      CNode*   pTarget  {};
+      QString  name;
+   };
+
+   std::vector<Link> links;
+
+   for (auto it = copy.cbegin(); it != copy.cend(); ++it)
+   {
+      CNode* pNode = it.key();
+
+      auto add = [&](CNode* pSource_, CNode* pTarget_, const QString& name_)
+      {
+         if (pSource_ == pSet || pTarget_ == pSet)
+            return;
+
+         // Arrows between cloned nodes are taken once, from their source
+         bool internal = copy.contains(pSource_) && copy.contains(pTarget_);
+
+         if (internal ? pSource_ == pNode : boundary_)
+            links.push_back({ pSource_, pTarget_, name_ });
+      };
+
+      if (m_pEdgeLayer)
+      {
+         for (int edge : m_pEdgeLayer->Incident(pNode))
+            add(m_pEdgeLayer->Source(edge), m_pEdgeLayer->Target(edge), m_pEdgeLayer->Name(edge));
+      }
+      else
+      {
+         for (CArrow* pArrow : pNode->Children())
+            add(pArrow->Source(), pArrow->Target(), pArrow->data(eID).toString());
+      }
+   }
+
+   for (const Link& link : links)
+   {
+      // Values of the arrow, looked up by its full name
+      Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(toID(link.pSource), toID(link.pTarget), link.name.toStdString()).AsQuery());
+
+      std::list<Function> fns = arrows.empty() ? std::list<Function>() : arrowValues(arrows.front());
+
+      createArrow(copy.value(link.pSource, link.pSource), copy.value(link.pTarget, link.pTarget), QString(), fns);
+   }
+
+   m_History.End();
+
+   refilter(copies, m_pFilter != nullptr);
+
+   emit updateStatistics(Statistics());
+
+   return copies;
+}
+
+//----------------------------------------------------------------------
+bool Scene::eraseNode(CNode* pNode_)
+{
+   // Positions computed so far are kept, the layout would reference the deleted item
+   finishLayout(true);
+
+   auto name = toID(pNode_);
+
+   // The node comes back with its arrows, those to the set node carry its
+   // properties
+   std::vector<Journal::Record> inverse { { Journal::ERecord::eAddNode, { name }, pNode_->pos() } };
+
+   if (!m_Replaying)
+   {
+      for (const Arrow& arrow : m_pLCategory->QueryArrows(Arrow(name, "*", "*").AsQuery()))
+         inverse.push_back({ Journal::ERecord::eAddArrow, { arrow.Name(), arrow.Source(), arrow.Target() }, QPointF(), arrowValues(arrow) });
+
+      for (const Arrow& arrow : m_pLCategory->QueryArrows(Arrow("*", name, "*").AsQuery()))
+      {
+         if (arrow.Source() != name)
+            inverse.push_back({ Journal::ERecord::eAddArrow, { arrow.Name(), arrow.Source(), arrow.Target() }, QPointF(), arrowValues(arrow) });
+      }
+   }
+
+   detach();
+
+   if (!m_pLCategory->EraseNode(name))
+      return false;
+
+   m_Properties.Erase(name);
+
+   unregisterNode(pNode_);
+
+   pNode_->DeInit();
+   removeItem(pNode_);
+   delete pNode_;
+
+   journal({ Journal::ERecord::eEraseNode, { name } });
+
+   history(tr("Delete node"), std::move(inverse));
+
+   emit updateStatistics(Statistics());
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+bool Scene::eraseArrow(const Arrow& arrow_)
+{
+   std::list<Function> values = m_Replaying ? std::list<Function>() : arrowValues(arrow_);
+
+   detach();
+
+   if (!m_pLCategory->EraseArrow(arrow_.Name()))
+      return false;
+
+   if (arrow_.Target() == sSet)
+   {
+      if (m_pLCategory->QueryArrows(Arrow(arrow_.Source(), sSet, "*").AsQuery()).empty())
+         m_Properties.Erase(arrow_.Source());
+      else
+         m_Properties.Assign(m_Properties.Insert(arrow_.Source()), FunctionValues(arrow_.Source(), sSet, *m_pLCategory));
+   }
+
+   if (CArrow* pArrow = dynamic_cast<CArrow*>(getItem(arrow_.Name().c_str())))
+   {
+      unregisterItem(pArrow);
+      removeItem(pArrow);
+      pArrow->DeInit();
+      delete pArrow;
+   }
+   else if (m_pEdgeLayer)
+   {
+      m_pEdgeLayer->Remove(m_pEdgeLayer->Find(arrow_.Name().c_str()));
+   }
+
+   journal({ Journal::ERecord::eEraseArrow, { arrow_.Name() } });
+
+   history(tr("Delete arrow"), { { Journal::ERecord::eAddArrow, { arrow_.Name(), arrow_.Source(), arrow_.Target() }, QPointF(), std::move(values) } });
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+void Scene::positionChanged(const CNode* pNode_)
+{
+   // Layout positions are committed in one batch once it finishes
+   if (!m_pLCategory || m_pLayout)
+      return;
+
+   // Drags only touch the scene geometry, the model is updated on release
+   m_Moved.insert(const_cast<CNode*>(pNode_));
+}
+
+//----------------------------------------------------------------------
+void Scene::commitMoved()
+{
+   if (m_Moved.isEmpty())
+      return;
+
+   std::vector<CNode*> moved(m_Moved.begin(), m_Moved.end());
+   m_Moved.clear();
+
+   commitPositions(moved);
+}
+
+//----------------------------------------------------------------------
+CNode* Scene::createNode(const QString& name_, const QPointF& pos_)
+{
+   if (!m_pLCategory)
+      return nullptr;
+
+   detach();
+
+   if (!m_pLCategory->AddNode(Node(name_.toStdString(), Node::EType::eObject)))
+      return nullptr;
+
+   journal({ Journal::ERecord::eAddNode, { name_.toStdString() }, pos_ });
+
+   history(tr("Create node"), { { Journal::ERecord::eEraseNode, { name_.toStdString() } } });
+
+   return addNodeItem(name_, pos_);
+}
+
+//----------------------------------------------------------------------
+CNode* Scene::createNode(const cat::Node& node_, const QPointF& pos_)
+{
+   if (!m_pLCategory)
+      return nullptr;
+
+   detach();
+
+   if (!m_pLCategory->AddNode(node_))
+      return nullptr;
+
+   return addNodeItem(node_.Name().c_str(), pos_);
+}
+
+//----------------------------------------------------------------------
+bool Scene::createArrow(CNode* pSource_, CNode* pTarget_, const QString& name_, std::list<cat::Function> pFns_)
 {
-   const QList<QGraphicsItem*> allItems = items();
-   for (QGraphicsItem* pItem : allItems)
+   if (!m_pLCategory)
+      return false;
+
+   auto source_name = pSource_->data(eID).toString();
+   auto target_name = pTarget_->data(eID).toString();
+
+   Arrow arrow = name_.isEmpty() ?
+      Arrow(source_name.toStdString(), target_name.toStdString()) :
+      Arrow(source_name.toStdString(), target_name.toStdString(), name_.toStdString());
+
+   detach();
+
+   if (!AddArrow(*m_pLCategory, arrow, pFns_))
+      return false;
+
+   if (arrow.Target() == sSet && m_Properties.Row(arrow.Source()) == PropertyStore::npos)
+      m_Properties.Assign(m_Properties.Insert(arrow.Source()), pFns_);
+
+   addArrowItem(pSource_, pTarget_, arrow.Name().c_str());
+
+   journal({ Journal::ERecord::eAddArrow, { arrow.Name(), arrow.Source(), arrow.Target() }, QPointF(), pFns_ });
+
+   history(tr("Create arrow"), { { Journal::ERecord::eEraseArrow, { arrow.Name() } } });
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+CNode* Scene::addNodeItem(const QString& name_, const QPointF& pos_)
+{
+   CNode* pItem = new CNode(pos_.x(), pos_.y(), name_);
+   addItem(pItem);
+   registerItem(pItem);
+
+   pItem->SetEdgeLayer(m_pEdgeLayer);
+
+   connect(pItem, &CNode::positionChanged, this, &Scene::positionChanged);
+   connect(pItem, &CNode::selectedChanged, this, &Scene::nodeSelected);
+
+   return pItem;
+}
+
+//----------------------------------------------------------------------
+void Scene::addArrowItem(CNode* pSource_, CNode* pTarget_, const QString& name_)
+{
+   if (m_pEdgeLayer)
    {
-      if (name_ == pItem->data(eID).toString())
-         return pItem;
+      m_pEdgeLayer->Add(pSource_, pTarget_, name_);
+      return;
    }
 
-   return nullptr;
+   CArrow* pItem = new CArrow(pSource_, pTarget_, name_);
+   addItem(pItem);
+   registerItem(pItem);
+}
+
+//----------------------------------------------------------------------
+QGraphicsItem* Scene::getItem(const QString& name_) const
+{
+   return m_Items.value(name_, nullptr);
+}
+
+//----------------------------------------------------------------------
+void Scene::registerItem(QGraphicsItem* pItem_)
+{
+   m_Items.insert(pItem_->data(eID).toString(), pItem_);
+}
+
+//----------------------------------------------------------------------
+void Scene::unregisterItem(QGraphicsItem* pItem_)
+{
+   auto it = m_Items.find(pItem_->data(eID).toString());
+   if (it != m_Items.end() && it.value() == pItem_)
+      m_Items.erase(it);
+}
+
+//----------------------------------------------------------------------
+void Scene::unregisterNode(CNode* pNode_)
+{
+   m_Moved.remove(pNode_);
+   m_Selected.remove(pNode_);
+
+   for (CArrow* pArrow : pNode_->Children())
+      unregisterItem(pArrow);
+
+   unregisterItem(pNode_);
 }
 
 //----------------------------------------------------------------------
@@ -622,489 +1071,1254 @@ void Scene::changeLabel(QGraphicsItem* pItem_) const
          return;
       }
 
-      Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(node_name, sSet, "*").AsQuery());
-      if (arrows.empty())
+      int row = m_Properties.Row(node_name);
+      if (row == PropertyStore::npos)
       {
          pItem->SetText("");
          return;
       }
 
-      const Arrow& arrow = arrows.front();
+      const TSetValue* pValue = m_Properties.Get(row, m_ShownName);
+      if (!pValue)
+         return;
+
+      if (const double* pVal = std::get_if<double>(pValue))
+      {
+         pItem->SetText(QString::number(*pVal));
+      }
+      else if (const float* pVal = std::get_if<float>(pValue))
+      {
+         pItem->SetText(QString::number(*pVal));
+      }
+      else if (const int* pVal = std::get_if<int>(pValue))
+      {
+         pItem->SetText(QString::number(*pVal));
+      }
+      else if (const std::string* pVal = std::get_if<std::string>(pValue))
+      {
+         pItem->SetText((*pVal).c_str());
+      }
+   }
+}
+
+//----------------------------------------------------------------------
+QMap<QString, QString> Scene::getRecord(QGraphicsItem* pItem_) const
+{
+   if (CNode* pItem = dynamic_cast<CNode*>(pItem_))
+   {
+      QMap<QString, QString> ret;
+
+      auto id = pItem->data(eID);
+      if (!id.isValid())
+         return ret;
+
+      auto node_name = id.toString();
+
+      ret.insert("id", node_name);
+
+      int row = m_Properties.Row(node_name.toStdString());
+      if (row == PropertyStore::npos)
+         return ret;
+
+      for (const Function& f : m_Properties.Values(row))
+         ret.insert(f.first.c_str(), ToString(f.second));
+
+      return ret;
+   }
+
+   return QMap<QString, QString>();
+}
+
+//----------------------------------------------------------------------
+bool Scene::isFiltered(const FunctionName& name_) const
+{
+   return m_pFilter && m_pFilter->Slot(name_) >= 0;
+}
+
+//----------------------------------------------------------------------
+bool Scene::matchesFilter(const CNode* pNode_) const
+{
+   auto node_name = toID(pNode_);
+
+   // Nodes without properties are left alone by the filter
+   int row = m_Properties.Row(node_name);
+   if (!m_pFilter || row == PropertyStore::npos)
+      return pNode_->isVisible();
+
+   const TSetValue id(node_name);
+
+   const std::vector<std::string>& slots = m_pFilter->Slots();
+   std::vector<const TSetValue*> values(slots.size());
+
+   for (size_t slot = 0; slot < slots.size(); ++slot)
+      values[slot] = slots[slot] == id_token ? &id : m_Properties.Get(row, slots[slot]);
+
+   return m_pFilter->Eval(values.data());
+}
+
+//----------------------------------------------------------------------
+void Scene::refilter(const std::vector<CNode*>& nodes_, bool reevaluate_)
+{
+   QStringList shown;
+   QStringList hidden;
+
+   QSet<CArrow*> arrows;
+   bool changed {};
+
+   for (CNode* pNode : nodes_)
+   {
+      if (!pNode)
+         continue;
+
+      if (reevaluate_)
+      {
+         bool visible = matchesFilter(pNode);
+
+         if (pNode->isVisible() != visible)
+         {
+            pNode->setVisible(visible);
+            changed = true;
+
+            for (CArrow* pArrow : pNode->Children())
+               arrows.insert(pArrow);
+         }
+      }
+
+      if (pNode->isVisible())
+         shown.push_back(pNode->data(eID).toString());
+      else
+         hidden.push_back(pNode->data(eID).toString());
+   }
+
+   for (CArrow* pArrow : arrows)
+      pArrow->SetVisibility(true);
+
+   if (m_pEdgeLayer && changed)
+      m_pEdgeLayer->update();
+
+   if (!shown.isEmpty() || !hidden.isEmpty())
+      emit updateRecords(shown, hidden);
+}
+
+//----------------------------------------------------------------------
+bool Scene::SaveBinary(const QString& path_) const
+{
+   if (!m_pLCategory)
+      return false;
+
+   // Nothing edits the model while this runs, no snapshot needed
+   Saver saver(m_pLCategory, path_);
+
+   return saver.Process();
+}
+
+//----------------------------------------------------------------------
+// A running save shares the model, the first edit made meanwhile moves the
+// scene onto a copy of its own and leaves the save's version untouched
+void Scene::detach()
+{
+   if (m_pLCategory && m_pLCategory.use_count() > 1)
+      m_pLCategory = std::make_shared<Node>(*m_pLCategory);
+}
+
+//----------------------------------------------------------------------
+void Scene::SaveAsync(const QString& path_)
+{
+   // Saved again, with the model as it is then, once the running save ends
+   if (m_pSaver)
+   {
+      m_SavePending = path_;
+      return;
+   }
+
+   startSave(path_, false);
+}
+
+//----------------------------------------------------------------------
+bool Scene::IsSaving() const
+{
+   return m_pSaver;
+}
+
+//----------------------------------------------------------------------
+void Scene::startSave(const QString& path_, bool compact_)
+{
+   if (!m_pLCategory)
+   {
+      if (!compact_)
+         emit saveFinished(false, path_, tr("Nothing to save"));
+
+      return;
+   }
+
+   // Edits made from here on go into the journal of the new file
+   m_Journal.Mark();
+
+   m_Compacting = compact_;
+
+   // The saver shares the model, an edit made while it writes detaches the
+   // scene first. A save without edits meanwhile copies nothing.
+   m_pSaver = new Saver(m_pLCategory, path_, this);
+
+   // Compaction is not a save of the user's, it runs silently
+   if (!compact_)
+      connect(m_pSaver, &Saver::progress, this, &Scene::saveProgress);
+
+   connect(m_pSaver, &Saver::saved, this, &Scene::modelSaved);
+
+   m_pSaver->start();
+}
+
+//----------------------------------------------------------------------
+void Scene::modelSaved(bool ok_)
+{
+   if (!m_pSaver || sender() != m_pSaver)
+      return;
+
+   endSave(ok_);
+}
+
+//----------------------------------------------------------------------
+void Scene::endSave(bool ok_)
+{
+   QString path   = m_pSaver->Path();
+   QString error  = m_pSaver->Error();
+
+   delete m_pSaver;
+   m_pSaver = nullptr;
+
+   if (ok_)
+      m_Journal.Rebase(path);
+
+   if (!m_Compacting)
+      emit saveFinished(ok_, path, error);
+
+   m_Compacting = false;
+
+   if (!m_SavePending.isEmpty())
+   {
+      QString next = m_SavePending;
+      m_SavePending.clear();
+
+      startSave(next, false);
+   }
+}
+
+//----------------------------------------------------------------------
+void Scene::waitSave()
+{
+   // Requested for the document being closed, the journal keeps the edits
+   // it would have written
+   m_SavePending.clear();
+
+   // The running save is of this document, its journal is rebased before
+   // the next document opens one. Its signal would come too late.
+   if (m_pSaver)
+   {
+      disconnect(m_pSaver, nullptr, this, nullptr);
+
+      m_pSaver->wait();
+
+      endSave(m_pSaver->Succeeded());
+   }
+
+   m_Compacting = false;
+}
+
+//----------------------------------------------------------------------
+void Scene::journal(const Journal::Record& record_)
+{
+   if (m_Replaying || !m_Journal.IsOpen())
+      return;
+
+   m_Journal.Append(record_);
+
+   // Replaying a journal this size on load costs more than rewriting the base
+   if (m_Journal.Size() > journal_compact_bytes && !m_pSaver)
+      startSave(m_Journal.Base(), true);
+}
+
+//----------------------------------------------------------------------
+void Scene::replay(const std::vector<Journal::Record>& records_)
+{
+   m_Replaying = true;
+
+   apply(records_);
+
+   m_Replaying = false;
+}
+
+//----------------------------------------------------------------------
+void Scene::apply(const std::vector<Journal::Record>& records_)
+{
+   if (records_.empty() || !m_pLCategory)
+      return;
+
+   // Runs of property records, position commits mostly, are applied in one
+   // model update as long as no node repeats
+   PropertyEdits        edits;
+   QSet<QGraphicsItem*> edited;
+
+   auto flush = [&]()
+   {
+      if (edits.empty())
+         return;
+
+      SetProperties(edits);
+
+      edits .clear();
+      edited.clear();
+   };
+
+   for (const Journal::Record& record : records_)
+   {
+      const auto& names = record.names;
+
+      auto node = [&](size_t index_) -> CNode*
+      {
+         return index_ < names.size() ? dynamic_cast<CNode*>(getItem(names[index_].c_str())) : nullptr;
+      };
+
+      if (record.type == Journal::ERecord::eSetProperties)
+      {
+         CNode* pNode = node(0);
+         if (!pNode)
+            continue;
+
+         if (edited.contains(pNode))
+            flush();
+
+         edits.push_back({ pNode, record.properties });
+         edited.insert(pNode);
+
+         // Items were placed from the base file
+         QPointF pos = pNode->pos();
+
+         for (const auto& [name, value] : record.properties)
+         {
+            if (const int* pVal = std::get_if<int>(&value))
+            {
+               if (name == x_token)
+                  pos.setX(*pVal);
+               else if (name == y_token)
+                  pos.setY(*pVal);
+            }
+         }
+
+         pNode->setPos(pos);
+
+         continue;
+      }
+
+      flush();
+
+      switch (record.type)
+      {
+      case Journal::ERecord::eAddNode:
+         if (!names.empty())
+            createNode(names[0].c_str(), record.pos);
+         break;
+
+      case Journal::ERecord::eEraseNode:
+         if (CNode* pNode = node(0))
+            eraseNode(pNode);
+         break;
+
+      case Journal::ERecord::eAddArrow:
+         if (CNode* pSource = node(1))
+         {
+            if (CNode* pTarget = node(2))
+               createArrow(pSource, pTarget, names[0].c_str(), record.properties);
+         }
+         break;
+
+      case Journal::ERecord::eEraseArrow:
+         if (!names.empty())
+         {
+            Arrow::List arrows = m_pLCategory->QueryArrows(Arrow("*", "*", names[0]).AsQuery());
+            if (!arrows.empty())
+               eraseArrow(arrows.front());
+         }
+         break;
+
+      case Journal::ERecord::eCloneNode:
+         if (CNode* pNode = node(0); pNode && names.size() > 1)
+            cloneNode(pNode, names[1], record.pos);
+         break;
+
+      case Journal::ERecord::eRemoveProperty:
+         if (CNode* pNode = node(0); pNode && names.size() > 1)
+            RemovePropertyFromNode(pNode, names[1]);
+         break;
+
+      default:
+         break;
+      }
+   }
+
+   flush();
+
+   // Applied moves are already in the model
+   m_Moved.clear();
+}
+
+//----------------------------------------------------------------------
+void Scene::history(const QString& text_, std::vector<Journal::Record>&& inverse_)
+{
+   // Journal replays restore the loaded state, there is nothing to undo
+   if (m_Replaying)
+      return;
+
+   m_History.Add(text_, std::move(inverse_));
+
+   emit historyChanged();
+}
+
+//----------------------------------------------------------------------
+std::list<Function> Scene::arrowValues(const Arrow& arrow_)
+{
+   // Querying the set node would copy every value in it
+   if (arrow_.Target() == sSet)
+      return m_Properties.Values(m_Properties.Row(arrow_.Source()));
+
+   return ArrowValues(arrow_, *m_pLCategory);
+}
+
+//----------------------------------------------------------------------
+void Scene::Undo()
+{
+   if (!m_pLCategory)
+      return;
+
+   // Pending edits are recorded first so that they are the ones undone
+   finishLayout(true);
+   commitMoved();
+
+   if (!m_History.CanUndo())
+      return;
+
+   revert(m_History.TakeUndo(), UndoHistory::ETarget::eRedo);
+}
+
+//----------------------------------------------------------------------
+void Scene::Redo()
+{
+   if (!m_pLCategory)
+      return;
+
+   finishLayout(true);
+   commitMoved();
+
+   if (!m_History.CanRedo())
+      return;
+
+   revert(m_History.TakeRedo(), UndoHistory::ETarget::eUndo);
+}
+
+//----------------------------------------------------------------------
+bool Scene::CanUndo() const
+{
+   return m_History.CanUndo();
+}
+
+//----------------------------------------------------------------------
+bool Scene::CanRedo() const
+{
+   return m_History.CanRedo();
+}
+
+//----------------------------------------------------------------------
+QString Scene::UndoText() const
+{
+   return m_History.UndoText();
+}
+
+//----------------------------------------------------------------------
+QString Scene::RedoText() const
+{
+   return m_History.RedoText();
+}
+
+//----------------------------------------------------------------------
+void Scene::revert(const UndoHistory::Entry& entry_, UndoHistory::ETarget target_)
+{
+   // The edits reverting this entry are recorded as the opposite one
+   m_History.Begin(entry_.text, target_);
+
+   apply(entry_.records);
+
+   m_History.End();
+
+   emit updateStatistics(Statistics());
+   emit historyChanged();
+}
+
+//----------------------------------------------------------------------
+void Scene::New()
+{
+   DeInit();
+   Init  ();
+}
+
+//----------------------------------------------------------------------
+void Scene::Filter(const QString& filter_)
+{
+   std::string filter = filter_.toStdString();
+
+   if (filter.empty())
+   {
+      m_pFilter.reset();
+
+      for (QGraphicsItem* pItem : m_Items)
+         pItem->setVisible(true);
+
+      if (m_pEdgeLayer)
+         m_pEdgeLayer->update();
+
+      return;
+   }
+
+   if (!m_pLCategory)
+      return;
+
+   try {
+      m_pFilter = std::make_unique<FilterProgram>(FilterProgram::Compile(filter));
+   }  catch (const std::invalid_argument& arg_) {
+      qDebug() << arg_.what();
+      return;
+   }
+
+   std::vector<CNode*>     nodes;
+   std::vector<int8_t>     visible;
+
+   evaluate(*m_pFilter, nodes, visible);
+
+   // Nodes first so that each arrow is updated once against its final ends
+   QSet<CArrow*> arrows;
+
+   for (size_t i = 0; i < nodes.size(); ++i)
+   {
+      if (nodes[i]->isVisible() == bool(visible[i]))
+         continue;
+
+      nodes[i]->setVisible(visible[i]);
+
+      for (CArrow* pArrow : nodes[i]->Children())
+         arrows.insert(pArrow);
+   }
+
+   for (CArrow* pArrow : arrows)
+      pArrow->SetVisibility(true);
+
+   if (m_pEdgeLayer)
+      m_pEdgeLayer->update();
+}
+
+//----------------------------------------------------------------------
+void Scene::evaluate(const FilterProgram& program_, std::vector<CNode*>& nodes_, std::vector<int8_t>& matches_) const
+{
+   const size_t slots   = program_.Slots().size();
+   const int    id_slot = program_.Slot(id_token);
+
+   std::vector<int> columns;
+   for (const std::string& name : program_.Slots())
+      columns.push_back(m_Properties.Column(name));
+
+   std::vector<int>        rows;
+   std::vector<TSetValue>  ids;
+
+   for (QGraphicsItem* pItem : m_Items)
+   {
+      CNode* pNode = dynamic_cast<CNode*>(pItem);
+      if (!pNode)
+         continue;
+
+      int row = m_Properties.Row(toID(pNode));
+      if (row == PropertyStore::npos)
+         continue;
+
+      nodes_.push_back(pNode);
+      rows  .push_back(row);
+
+      if (id_slot >= 0)
+         ids.push_back(TSetValue(toID(pNode)));
+   }
+
+   matches_.resize(nodes_.size());
+
+   // The store is only read here, rows are evaluated straight from its columns
+   parallel_for(nodes_.size(), [&](size_t begin_, size_t end_)
+   {
+      std::vector<const TSetValue*> values(slots);
+
+      for (size_t i = begin_; i < end_; ++i)
+      {
+         for (size_t slot = 0; slot < slots; ++slot)
+            values[slot] = m_Properties.Get(rows[i], columns[slot]);
+
+         if (id_slot >= 0)
+            values[id_slot] = &ids[i];
+
+         matches_[i] = program_.Eval(values.data());
+      }
+   });
+}
+
+//----------------------------------------------------------------------
+void Scene::SelectAll()
+{
+   applySelection(nodes(), [](CNode*) { return true; });
+}
+
+//----------------------------------------------------------------------
+void Scene::SelectNone()
+{
+   applySelection(std::vector<CNode*>(m_Selected.begin(), m_Selected.end()), [](CNode*) { return false; });
+}
+
+//----------------------------------------------------------------------
+void Scene::InvertSelection()
+{
+   applySelection(nodes(), [](CNode* pNode_) { return !pNode_->isSelected(); });
+}
+
+//----------------------------------------------------------------------
+bool Scene::SelectMatching(const QString& filter_)
+{
+   std::unique_ptr<FilterProgram> pProgram;
+
+   try {
+      pProgram = std::make_unique<FilterProgram>(FilterProgram::Compile(filter_.toStdString()));
+   }  catch (const std::invalid_argument& arg_) {
+      qDebug() << arg_.what();
+      return false;
+   }
+
+   std::vector<CNode*>  nodes;
+   std::vector<int8_t>  matches;
+
+   evaluate(*pProgram, nodes, matches);
+
+   QSet<CNode*> matching;
+   matching.reserve((int)nodes.size());
+
+   for (size_t i = 0; i < nodes.size(); ++i)
+   {
+      if (matches[i])
+         matching.insert(nodes[i]);
+   }
+
+   applySelection(this->nodes(), [&](CNode* pNode_) { return matching.contains(pNode_); });
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+void Scene::SelectArea(const QRectF& rect_, Qt::ItemSelectionOperation operation_)
+{
+   // Looked up in the scene's index, only the nodes under the band
+   QSet<CNode*> area;
+
+   for (QGraphicsItem* pItem : items(rect_, Qt::IntersectsItemShape))
+   {
+      CNode* pNode = dynamic_cast<CNode*>(pItem);
+      if (pNode && pNode->isVisible())
+         area.insert(pNode);
+   }
+
+   std::vector<CNode*> nodes(area.begin(), area.end());
+
+   if (operation_ == Qt::AddToSelection)
+   {
+      applySelection(nodes, [](CNode*) { return true; });
+      return;
+   }
+
+   // Replacing only touches the nodes selected so far and those in the area
+   for (CNode* pNode : m_Selected)
+   {
+      if (!area.contains(pNode))
+         nodes.push_back(pNode);
+   }
+
+   applySelection(nodes, [&](CNode* pNode_) { return area.contains(pNode_); });
+}
+
+//----------------------------------------------------------------------
+const QSet<CNode*>& Scene::Selection() const
+{
+   return m_Selected;
+}
+
+//----------------------------------------------------------------------
+std::vector<CNode*> Scene::nodes() const
+{
+   std::vector<CNode*> ret;
+   ret.reserve(m_Items.size());
+
+   // Hidden items cannot be selected
+   for (QGraphicsItem* pItem : m_Items)
+   {
+      CNode* pNode = dynamic_cast<CNode*>(pItem);
+      if (pNode && pNode->isVisible())
+         ret.push_back(pNode);
+   }
 
-      std::list<Function> fns = function_values(arrow.Source(), arrow.Target(), m_pLCategory);
+   return ret;
+}
 
-      for (Function& f : fns)
-      {
-         if (f.first == m_ShownName)
-         {
-            if (const double* pVal = std::get_if<double>(&f.second))
-            {
-               pItem->SetText(QString::number(*pVal));
-            }
-            else if (const float* pVal = std::get_if<float>(&f.second))
-            {
-               pItem->SetText(QString::number(*pVal));
-            }
-            else if (const int* pVal = std::get_if<int>(&f.second))
-            {
-               pItem->SetText(QString::number(*pVal));
-            }
-            else if (const std::string* pVal = std::get_if<std::string>(&f.second))
-            {
-               pItem->SetText((*pVal).c_str());
-            }
-         }
-      }
-   }
+//----------------------------------------------------------------------
+std::vector<QGraphicsItem*> Scene::selection() const
+{
+   return std::vector<QGraphicsItem*>(m_Selected.begin(), m_Selected.end());
 }
 
 //----------------------------------------------------------------------
-QMap<QString, QString> Scene::getRecord(QGraphicsItem* pItem_) const
+void Scene::publishSelection()
 {
-   if (CNode* pItem = dynamic_cast<CNode*>(pItem_))
+   std::set<FunctionName> mixed;
+
+   if (m_Selected.size() == 1)
    {
-      QMap<QString, QString> ret;
+      emit updateNodeData(m_Properties.Values(m_Properties.Row(toID(*m_Selected.begin()))), mixed);
+      return;
+   }
 
-      auto id = pItem->data(eID);
-      if (!id.isValid())
-         return ret;
+   // Merged column by column from the store, the nodes are not visited
+   std::vector<int> rows;
+   rows.reserve(m_Selected.size());
 
-      auto node_name = id.toString();
+   for (CNode* pNode : m_Selected)
+      rows.push_back(m_Properties.Row(toID(pNode)));
 
-      ret.insert("id", node_name);
+   std::list<Function> values = m_Properties.Values(rows, mixed);
 
-      Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(node_name.toStdString(), sSet, "*").AsQuery());
-      if (arrows.empty())
-         return ret;
+   emit updateNodeData(values, mixed);
+}
 
-      const Arrow& arrow = arrows.front();
+//----------------------------------------------------------------------
+template <typename TFn>
+void Scene::applySelection(const std::vector<CNode*>& nodes_, const TFn& selected_)
+{
+   bool changed {};
 
-      std::list<Function> fns = function_values(arrow.Source(), arrow.Target(), m_pLCategory);
+   {
+      // Each item would publish its own change, the scene publishes one
+      QSignalBlocker blocker(this);
 
-      for (Function& f : fns)
+      for (CNode* pNode : nodes_)
       {
-         if (const double* pVal = std::get_if<double>(&f.second))
-         {
-            ret.insert(f.first.c_str(), QString::number(*pVal));
-         }
-         else if (const float* pVal = std::get_if<float>(&f.second))
-         {
-            ret.insert(f.first.c_str(), QString::number(*pVal));
-         }
-         else if (const int* pVal = std::get_if<int>(&f.second))
-         {
-            ret.insert(f.first.c_str(), QString::number(*pVal));
-         }
-         else if (const std::string* pVal = std::get_if<std::string>(&f.second))
+         bool selected = selected_(pNode);
+
+         if (pNode->isSelected() != selected)
          {
-            ret.insert(f.first.c_str(), QString((*pVal).c_str()));
+            pNode->setSelected(selected);
+            changed = true;
          }
       }
-
-      return ret;
    }
 
-   return QMap<QString, QString>();
+   if (changed)
+      emit QGraphicsScene::selectionChanged();
 }
 
 //----------------------------------------------------------------------
-static void readif(std::ifstream& stream_, std::string& str_)
+void Scene::nodeSelected(CNode* pNode_)
 {
-   size_t string_sz{};
-   stream_.read((char*)&string_sz, sizeof(string_sz));
+   if (pNode_->isSelected())
+      m_Selected.insert(pNode_);
+   else
+      m_Selected.remove(pNode_);
+}
 
-   str_.resize(string_sz);
+//----------------------------------------------------------------------
+void Scene::ChangeLabel(const QString& name_)
+{
+   m_ShownName = name_.toStdString();
 
-   stream_.read(str_.data(), string_sz);
+   for (QGraphicsItem* pItem : m_Items)
+      changeLabel(pItem);
 }
 
 //----------------------------------------------------------------------
-static void readif(std::ifstream& stream_, TSetValue& value_)
+QList<QMap<QString, QString>> Scene::GetDescription() const
 {
-   size_t type_ind{};
-   stream_.read((char*)&type_ind, sizeof(type_ind));
+   QList<QMap<QString, QString>> ret;
 
-   if (type_ind == (size_t)ESetTypes::eDouble)
-   {
-      double val{};
-      stream_.read((char*)&val, sizeof(val));
-      value_ = val;
-   }
-   else if (type_ind == (size_t)ESetTypes::eFloat)
-   {
-      float val{};
-      stream_.read((char*)&val, sizeof(val));
-      value_ = val;
-   }
-   else if (type_ind == (size_t)ESetTypes::eInt)
+   QList<QGraphicsItem*> nodes = items();
+
+   for (QGraphicsItem* pNode : nodes)
    {
-      int val{};
-      stream_.read((char*)&val, sizeof(val));
-      value_ = val;
+      if (pNode->isVisible())
+      {
+         auto record = getRecord(pNode);
+         if (!record.empty())
+            ret.push_back(record);
+      }
    }
-   else if (type_ind == (size_t)ESetTypes::eString)
+
+   return ret;
+}
+
+//----------------------------------------------------------------------
+QStringList Scene::VisibleNodes() const
+{
+   QStringList ret;
+
+   for (QGraphicsItem* pItem : items())
    {
-      std::string str;
-      readif(stream_, str);
-      value_ = str;
+      if (pItem->isVisible() && dynamic_cast<CNode*>(pItem))
+         ret.push_back(pItem->data(eID).toString());
    }
+
+   return ret;
 }
 
 //----------------------------------------------------------------------
-static void write2of(std::ofstream& stream_, const std::string& str_)
+const PropertyStore& Scene::Properties() const
 {
-   auto ssize = str_.size();
-   stream_.write((char*)&ssize, sizeof(ssize));
-   stream_.write(str_.c_str(), str_.size());
+   return m_Properties;
 }
 
 //----------------------------------------------------------------------
-static void write2of(std::ofstream& stream_, const TSetValue& value_)
+bool Scene::Build(const QString& path_)
 {
-   size_t type_ind = value_.index();
-
-   stream_.write((char*)&type_ind, sizeof(type_ind));
-
-   std::visit([&](const auto& elem_)
-   {
-      if constexpr (std::is_same_v<std::decay_t<decltype(elem_)>, std::string>)
-            write2of(stream_, elem_);
-      else
-            stream_.write((char*)&elem_, sizeof(elem_));
-   }, value_);
+   return load(path_, Loader::EFormat::eText);
 }
 
 //----------------------------------------------------------------------
-static void write2of(std::ofstream& stream_, const Function& fn_)
+bool Scene::LoadBinary(const QString& path_)
 {
-   write2of(stream_, fn_.first);
-   write2of(stream_, fn_.second);
+   return load(path_, Loader::EFormat::eBinary);
 }
 
 //----------------------------------------------------------------------
-bool Scene::SaveBinary(const QString& path_) const
+bool Scene::load(const QString& path_, Loader::EFormat format_)
 {
-   if (!m_pLCategory)
-      return false;
+   CancelLoad();
+   waitSave();
 
-   std::ofstream output(path_.toStdString(), std::ios::out | std::ios::binary);
-   if (!output.is_open())
-      return false;
+   emit documentClosed();
 
-   auto nodes = m_pLCategory->QueryNodes("*");
+   m_Journal.Close();
 
-   size_t sz = nodes.size();
+   m_History.Clear();
+   emit historyChanged();
 
-   output.write((char*)&sz, sizeof(sz));
+   Loader loader(path_, format_);
+   if (!loader.Process())
+      return false;
 
-   for (const auto& node : nodes)
-      write2of(output, node.Name());
+   m_pLCategory = loader.TakeCategory();
+   m_Properties = loader.TakeProperties();
 
-   auto arrows = m_pLCategory->QueryArrows(Arrow("*", "*", "*").AsQuery());
+   std::vector<Loader::NodeRecord> nodes = loader.TakeNodes();
+   std::vector<CNode*> items;
+   items.reserve(nodes.size());
 
-   sz = arrows.size() - nodes.size();
+   for (const auto& node : nodes)
+      items.push_back(addNodeItem(node.name, node.pos));
 
-   output.write((char*)&sz, sizeof(sz));
+   for (const auto& arrow : loader.TakeArrows())
+      addArrowItem(items[arrow.source], items[arrow.target], arrow.name);
 
-   for (const auto& arrow : arrows)
+   // Nothing is written until the model is edited
+   if (format_ == Loader::EFormat::eBinary)
    {
-      // Skipping identity
-      if (arrow.Source() == arrow.Target())
-         continue;
+      replay(Journal::Read(path_));
 
-      write2of(output, arrow.Name   ());
-      write2of(output, arrow.Source ());
-      write2of(output, arrow.Target ());
+      m_Journal.Open(path_);
+   }
 
-      std::list<Function> fns = function_values(arrow.Source(), arrow.Target(), m_pLCategory);
+   emit updateStatistics(Statistics());
 
-      sz = fns.size();
+   return true;
+}
 
-      output.write((char*)&sz, sizeof(sz));
+//----------------------------------------------------------------------
+void Scene::LoadAsync(const QString& path_, Loader::EFormat format_)
+{
+   CancelLoad();
+   waitSave();
 
-      for (const Function& fn : fns)
-         write2of(output, fn);
-   }
+   emit documentClosed();
 
-   output.close();
+   // The model is swapped in once all items are added, edits are
+   // disabled until then
+   m_pLCategory = nullptr;
 
-   return true;
+   m_Journal.Close();
+   m_LoadPath = format_ == Loader::EFormat::eBinary ? path_ : QString();
+
+   m_History.Clear();
+   emit historyChanged();
+
+   m_pLoader = new Loader(path_, format_, this);
+
+   connect(m_pLoader, &Loader::nodesReady, this, &Scene::nodesLoaded);
+   connect(m_pLoader, &Loader::loaded, this, &Scene::modelLoaded);
+
+   m_pLoader->start();
 }
 
 //----------------------------------------------------------------------
-void Scene::New()
+void Scene::CancelLoad()
 {
-   DeInit();
-   Init  ();
+   if (!m_pLoader)
+      return;
+
+   finishLoad(false);
 }
 
 //----------------------------------------------------------------------
-bool eval_expr(TToken name_, TToken value_, TToken op_, const std::list<Function>& fns_)
+bool Scene::IsLoading() const
 {
-   std::string name = std::get<std::string>(name_);
+   return m_pLoader;
+}
 
-   bool (*cmp_d)(double left_, double right_);
-   bool (*cmp_f)(float left_, float right_);
-   bool (*cmp_i)(int left_, int right_);
-   bool (*cmp_str)(const std::string & left_, const std::string & right_);
+//----------------------------------------------------------------------
+void Scene::nodesLoaded()
+{
+   if (!m_pLoader || sender() != m_pLoader)
+      return;
 
-   if       (std::holds_alternative<EQ>(op_))
-   {
-      cmp_d = [](double left_, double right_) { return left_ == right_; };
-      cmp_f = [](float left_, float right_) { return left_ == right_; };
-      cmp_i = [](int left_, int right_) { return left_ == right_; };
-      cmp_str = [](const std::string& left_, const std::string& right_) { return left_ == right_; };
-   }
-   else if  (std::holds_alternative<NEQ>(op_))
-   {
-      cmp_d = [](double left_, double right_) { return left_ != right_; };
-      cmp_f = [](float left_, float right_) { return left_ != right_; };
-      cmp_i = [](int left_, int right_) { return left_ != right_; };
-      cmp_str = [](const std::string& left_, const std::string& right_) { return left_ != right_; };
-   }
+   m_LoadNodes = m_pLoader->TakeNodes();
+   m_LoadItems.reserve(m_LoadNodes.size());
+
+   m_pLoadTimer->start(0);
+}
+
+//----------------------------------------------------------------------
+void Scene::modelLoaded(bool ok_)
+{
+   if (!m_pLoader || sender() != m_pLoader)
+      return;
 
-   for (const Function& f : fns_)
+   if (!ok_)
    {
-      if (f.first == name)
-      {
-         if (const double* pVal = std::get_if<double>(&f.second))
-         {
-            return cmp_d(*pVal, std::get<double>(value_));
-         }
-         else if (const float* pVal = std::get_if<float>(&f.second))
-         {
-            return cmp_f(*pVal, std::get<float>(value_));
-         }
-         else if (const int* pVal = std::get_if<int>(&f.second))
-         {
-            return cmp_i(*pVal, std::get<int>(value_));
-         }
-         else if (const std::string* pVal = std::get_if<std::string>(&f.second))
-         {
-            return cmp_str(*pVal, std::get<std::string>(value_));
-         }
-      }
+      finishLoad(false);
+      return;
    }
 
-   return false;
+   m_LoadArrows   = m_pLoader->TakeArrows();
+   m_ModelLoaded  = true;
+
+   m_pLoadTimer->start(0);
 }
 
-//-----------------------------------------------------------------------------------------
-static bool rec_eval(std::list<TToken>::iterator it_, std::list<TToken>::iterator end_, const std::list<Function>& fns_)
+//----------------------------------------------------------------------
+void Scene::loadStep()
 {
-   const TToken& name   = *it_; ++it_;
-   if (it_ == end_)
-      throw std::invalid_argument("Incorrect expression");
+   QElapsedTimer clock;
+   clock.start();
 
-   const TToken& op     = *it_; ++it_;
-   if (it_ == end_)
-      throw std::invalid_argument("Incorrect expression");
+   size_t count{};
 
-   const TToken& val    = *it_; ++it_;
+   while (m_LoadItems.size() < m_LoadNodes.size() || (m_ModelLoaded && m_LoadedArrows < m_LoadArrows.size()))
+   {
+      if (m_LoadItems.size() < m_LoadNodes.size())
+      {
+         const auto& node = m_LoadNodes[m_LoadItems.size()];
+         m_LoadItems.push_back(addNodeItem(node.name, node.pos));
+      }
+      else
+      {
+         const auto& arrow = m_LoadArrows[m_LoadedArrows++];
+         addArrowItem(m_LoadItems[arrow.source], m_LoadItems[arrow.target], arrow.name);
+      }
 
-   bool ret = eval_expr(name, val, op, fns_);
+      // Checking the clock every item is measurable on big files
+      if (++count % 64 == 0 && clock.elapsed() >= load_slice_ms)
+         break;
+   }
 
-   if (it_ == end_)
-      return ret;
+   emit loadProgress(int(m_LoadItems.size() + m_LoadedArrows), int(m_LoadNodes.size() + m_LoadArrows.size()));
 
-   if       (std::holds_alternative<OR>(*it_))
-   {
-      return ret || rec_eval(++it_, end_, fns_);
-   }
-   else if  (std::holds_alternative<AND>(*it_))
-   {
-      return ret && rec_eval(++it_, end_, fns_);
-   }
+   if (m_LoadItems.size() < m_LoadNodes.size() || (m_ModelLoaded && m_LoadedArrows < m_LoadArrows.size()))
+      return;
 
-   throw std::invalid_argument("Incorrect expression");
+   if (m_ModelLoaded)
+      finishLoad(true);
+   else
+      m_pLoadTimer->stop();
 }
 
 //----------------------------------------------------------------------
-void Scene::Filter(const QString& filter_)
+void Scene::finishLoad(bool ok_)
 {
-   try {
-      std::string filter = filter_.toStdString();
+   m_pLoadTimer->stop();
 
-      QList<QGraphicsItem*> nodes = items();
+   QSet<CNode*> pinned;
+   bool scatter {};
 
-      if (filter.empty())
-      {
-         for (QGraphicsItem* pNode : nodes)
-            pNode->setVisible(true);
+   if (ok_)
+   {
+      m_pLCategory = m_pLoader->TakeCategory();
+      m_Properties = m_pLoader->TakeProperties();
 
-         return;
+      for (size_t i = 0; i < m_LoadItems.size(); ++i)
+      {
+         if (m_LoadNodes[i].placed)
+            pinned.insert(m_LoadItems[i]);
+         else
+            scatter = true;
       }
+   }
 
-      std::list<TToken> tks = Tokenizer::Process(filter);
-
-      for (QGraphicsItem* it : nodes)
-      {
-         auto id = it->data(eID);
+   // A cancelled loader may be deep in parsing where it cannot check for the
+   // cancel, it finishes on its own and deletes itself instead of holding up
+   // the GUI thread. Without a parent nothing waits for it on exit either.
+   m_pLoader->disconnect(this);
+   m_pLoader->Cancel();
+   m_pLoader->setParent(nullptr);
 
-         CNode* pNode = dynamic_cast<CNode*>(it);
-         if (!pNode)
-            continue;
+   connect(m_pLoader, &QThread::finished, m_pLoader, &QObject::deleteLater);
 
-         auto node_name = id.toString().toStdString();
+   if (m_pLoader->isFinished())
+      m_pLoader->deleteLater();
 
-         Arrow::List arrows = m_pLCategory->QueryArrows(Arrow(node_name, sSet).AsQuery());
-         if (arrows.empty())
-            continue;
+   m_pLoader = nullptr;
 
-         const Arrow& arrow = arrows.front();
+   m_LoadNodes    .clear();
+   m_LoadArrows   .clear();
+   m_LoadItems    .clear();
+   m_LoadedArrows = 0;
+   m_ModelLoaded  = false;
 
-         std::list<Function> fns = function_values(arrow.Source(), arrow.Target(), m_pLCategory);
+   if (ok_ && !m_LoadPath.isEmpty())
+   {
+      std::vector<Journal::Record> records = Journal::Read(m_LoadPath);
 
-         fns.push_back({ FunctionName(id_token), TSetValue(node_name) });
+      replay(records);
 
-         bool success = rec_eval(tks.begin(), tks.end(), fns);
+      m_Journal.Open(m_LoadPath);
 
-         pNode->SetVisibility(success);
-      }
-   }  catch (const std::invalid_argument& arg_) {
-      qDebug() << arg_.what();
+      // Folded into the base in the background, the next load starts clean
+      if (!records.empty() && !m_pSaver)
+         startSave(m_LoadPath, true);
    }
+
+   m_LoadPath.clear();
+
+   emit updateStatistics(Statistics());
+   emit loadFinished(ok_);
+
+   // Nodes without stored coordinates are laid out around the placed ones
+   if (scatter)
+      startLayout(pinned, true);
 }
 
 //----------------------------------------------------------------------
-void Scene::ChangeLabel(const QString& name_)
+void Scene::Layout()
 {
-   m_ShownName = name_.toStdString();
+   if (!m_pLCategory)
+      return;
 
-   QList<QGraphicsItem*> nodes = items();
-   for (QGraphicsItem* pNode : nodes)
-      changeLabel(pNode);
+   startLayout(QSet<CNode*>(), false);
 }
 
 //----------------------------------------------------------------------
-QList<QMap<QString, QString>> Scene::GetDescription() const
+void Scene::StopLayout()
 {
-   QList<QMap<QString, QString>> ret;
+   finishLayout(false);
+}
 
-   QList<QGraphicsItem*> nodes = items();
+//----------------------------------------------------------------------
+void Scene::SetBatchedEdges(bool batched_)
+{
+   if (m_BatchedEdges == batched_)
+      return;
 
-   for (QGraphicsItem* pNode : nodes)
+   m_BatchedEdges = batched_;
+
+   struct Record
    {
-      if (pNode->isVisible())
+      CNode*   pSource {};
+      CNode*   pTarget {};
+      QString  name;
+   };
+
+   std::vector<Record> arrows;
+
+   // Taking the arrows out of the current representation
+   if (m_pEdgeLayer)
+   {
+      for (int edge = 0; edge < m_pEdgeLayer->Slots(); ++edge)
       {
-         auto record = getRecord(pNode);
-         if (!record.empty())
-            ret.push_back(record);
+         if (m_pEdgeLayer->Source(edge))
+            arrows.push_back({ m_pEdgeLayer->Source(edge), m_pEdgeLayer->Target(edge), m_pEdgeLayer->Name(edge) });
       }
-   }
 
-   return ret;
-}
+      removeItem(m_pEdgeLayer);
+      delete m_pEdgeLayer;
+      m_pEdgeLayer = nullptr;
+   }
+   else
+   {
+      std::vector<CArrow*> items;
 
-//----------------------------------------------------------------------
-bool Scene::Build(const QString& path_)
-{
-   Parser prs;
-   if (!prs.Parse(path_.toStdString().c_str()))
-      return false;
+      for (QGraphicsItem* pItem : m_Items)
+      {
+         if (CArrow* pArrow = dynamic_cast<CArrow*>(pItem))
+            items.push_back(pArrow);
+      }
 
-   if (!prs.Data() || prs.Data()->Type() != Node::EType::eSCategory)
-      return false;
+      for (CArrow* pArrow : items)
+      {
+         arrows.push_back({ pArrow->Source(), pArrow->Target(), pArrow->data(eID).toString() });
 
-   m_pLCategory = prs.Data();
+         unregisterItem(pArrow);
+         removeItem(pArrow);
+         pArrow->DeInit();
+         delete pArrow;
+      }
+   }
 
-   for (auto& node : m_pLCategory->QueryNodes("*"))
+   if (m_BatchedEdges)
    {
-      CNode* pItem = new CNode(scene_size * 0.5, scene_size * 0.5, node.Name().c_str());
-      addItem(pItem);
+      m_pEdgeLayer = new CEdgeLayer;
+      addItem(m_pEdgeLayer);
+   }
 
-      connect(pItem, &CNode::positionChanged, this, &Scene::positionChanged);
+   for (QGraphicsItem* pItem : m_Items)
+   {
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+         pNode->SetEdgeLayer(m_pEdgeLayer);
    }
 
-   for (auto& arrow : m_pLCategory->QueryArrows(Arrow("*", "*").AsQuery()))
+   for (const Record& arrow : arrows)
    {
-      CNode* pSource = (CNode*)getItem(arrow.Source().c_str());
-      CNode* pTarget = (CNode*)getItem(arrow.Target().c_str());
+      addArrowItem(arrow.pSource, arrow.pTarget, arrow.name);
 
-      CArrow* pItem = new CArrow(pSource, pTarget, arrow.Name().c_str());
-      addItem(pItem);
+      // Arrows hidden by a filter stay hidden as items
+      if (CArrow* pArrow = dynamic_cast<CArrow*>(getItem(arrow.name)))
+         pArrow->SetVisibility(true);
    }
+}
 
-   emit updateStatistics(Statistics());
-
-   return true;
+//----------------------------------------------------------------------
+bool Scene::BatchedEdges() const
+{
+   return m_BatchedEdges;
 }
 
 //----------------------------------------------------------------------
-bool Scene::LoadBinary(const QString& path_)
+void Scene::startLayout(const QSet<CNode*>& pinned_, bool scatter_)
 {
-   std::ifstream input(path_.toStdString(), std::ios::in | std::ios::binary);
-   if (!input.is_open())
-      return false;
+   StopLayout();
 
-   size_t node_count{};
-   input.read((char*)&node_count, sizeof(node_count));
+   std::vector<ForceLayout::Point> positions;
+   std::vector<bool>               pinned;
+   std::vector<ForceLayout::Edge>  edges;
 
-   for (int i = 0; i < node_count; ++i)
+   QHash<CNode*, uint32_t> indices;
+
+   for (QGraphicsItem* pItem : m_Items)
    {
-      Node::NName name;
-      readif(input, name);
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+      {
+         indices.insert(pNode, (uint32_t)m_LayoutItems.size());
 
-      if (!createNode(name.c_str(), QPointF(scene_size * 0.5, scene_size * 0.5)))
-         return false;
+         m_LayoutItems.push_back(pNode);
+         positions.push_back({ pNode->pos().x(), pNode->pos().y() });
+         pinned.push_back(pinned_.contains(pNode));
+      }
    }
 
-   size_t arrow_count{};
-   input.read((char*)&arrow_count, sizeof(arrow_count));
-
-   for (int i = 0; i < arrow_count; ++i)
+   for (CNode* pNode : m_LayoutItems)
    {
-      Arrow::AName name;
-      readif(input, name);
-
-      std::string source;
-      readif(input, source);
+      for (CArrow* pArrow : pNode->Children())
+      {
+         // Every arrow is a child of both ends, taking it once from the source
+         if (pArrow->Source() == pNode && pArrow->Target() != pNode)
+            edges.emplace_back(indices.value(pNode), indices.value(pArrow->Target()));
+      }
 
-      std::string target;
-      readif(input, target);
+      if (m_pEdgeLayer)
+      {
+         for (int edge : m_pEdgeLayer->Incident(pNode))
+         {
+            if (m_pEdgeLayer->Source(edge) == pNode && m_pEdgeLayer->Target(edge) != pNode)
+               edges.emplace_back(indices.value(pNode), indices.value(m_pEdgeLayer->Target(edge)));
+         }
+      }
+   }
 
-      CNode* pSource = (CNode*)getItem(source.c_str());
-      CNode* pTarget = (CNode*)getItem(target.c_str());
+   ForceLayout layout(std::move(positions), std::move(pinned), edges, scene_size, scatter_);
 
-      assert(pSource && pTarget);
+   m_pLayout = new LayoutJob(std::move(layout), this);
+   m_pLayout->start();
 
-      if (!pSource || !pTarget)
-         return false;
+   m_pLayoutTimer->start(layout_interval_ms);
+}
 
-      size_t prop_count{};
-      input.read((char*)&prop_count, sizeof(prop_count));
+//----------------------------------------------------------------------
+void Scene::applyLayout()
+{
+   if (!m_pLayout)
+      return;
 
-      std::list<Function> fns; fns.resize(prop_count);
+   if (m_LayoutApplied >= m_LayoutPositions.size())
+   {
+      // Checked before taking the snapshot, otherwise the last one may be missed
+      bool finished = m_pLayout->isFinished();
 
-      auto itFns = fns.begin();
-      for (int i = 0; i < prop_count; ++i, ++itFns)
+      if (m_pLayout->Snapshot(m_LayoutRevision, m_LayoutPositions))
+         m_LayoutApplied = 0;
+      else
       {
-         readif(input, itFns->first);
-         readif(input, itFns->second);
+         if (finished)
+            finishLayout(true);
+
+         return;
       }
+   }
 
-      std::optional<int> node_x;
-      std::optional<int> node_y;
+   QElapsedTimer clock;
+   clock.start();
 
-      for (auto& fn : fns)
-      {
-         if (fn.first == x_token && fn.second.index() == (size_t)ESetTypes::eInt)
-            node_x = std::get<(size_t)ESetTypes::eInt>(fn.second);
+   while (m_LayoutApplied < m_LayoutPositions.size())
+   {
+      const ForceLayout::Point& pos = m_LayoutPositions[m_LayoutApplied];
+      m_LayoutItems[m_LayoutApplied]->setPos(pos.x, pos.y);
 
-         if (fn.first == y_token && fn.second.index() == (size_t)ESetTypes::eInt)
-            node_y = std::get<(size_t)ESetTypes::eInt>(fn.second);
-      }
+      if (++m_LayoutApplied % 256 == 0 && clock.elapsed() >= load_slice_ms)
+         break;
+   }
+}
 
-      if (node_x && node_y)
-         pSource->setPos(node_x.value(), node_y.value());
+//----------------------------------------------------------------------
+void Scene::finishLayout(bool commit_)
+{
+   if (!m_pLayout)
+      return;
 
-      if (!createArrow(pSource, pTarget, name.c_str(), fns))
-         printf("Error creating arrow: %s \n", name.c_str());
-   }
+   m_pLayoutTimer->stop();
 
-   input.close();
+   delete m_pLayout;
+   m_pLayout = nullptr;
 
-   emit updateStatistics(Statistics());
+   if (commit_)
+      commitPositions(m_LayoutItems);
 
-   return true;
+   m_LayoutItems     .clear();
+   m_LayoutPositions .clear();
+   m_LayoutApplied   = 0;
+   m_LayoutRevision  = 0;
+}
+
+//----------------------------------------------------------------------
+void Scene::commitPositions(const std::vector<CNode*>& nodes_)
+{
+   PropertyEdits edits;
+   edits.reserve(nodes_.size());
+
+   for (CNode* pNode : nodes_)
+      edits.push_back({ pNode, { { x_token, (int)pNode->pos().x() }, { y_token, (int)pNode->pos().y() } } });
+
+   m_History.Begin(tr("Move nodes"));
+
+   SetProperties(edits);
+
+   m_History.End();
 }
@@ -2,18 +2,31 @@
 #define SCENE_H
 
 #include <memory>
+#include <set>
+#include <vector>
 
 #include <QGraphicsScene>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 
 #include "node.h"
 #include "carrow.h"
 #include "cnode.h"
+#include "loader.h"
+#include "layout.h"
+#include "propertystore.h"
+#include "journal.h"
+#include "undohistory.h"
 
 class QMenu;
 class QAction;
 class QGraphicsSceneMouseEvent;
 class QContextMenuEvent;
+class QTimer;
+class FilterProgram;
+class CEdgeLayer;
+class Saver;
 
 class Scene : public QGraphicsScene
 {
@@ -26,43 +39,154 @@ public:
    void Init();
    void DeInit();
 
+   // Properties to set per node, values of the same name are replaced
+   using PropertyEdits = std::vector<std::pair<QGraphicsItem*, std::list<cat::Function>>>;
+
+   // Without an item the property is set on, or removed from, all selected
+   // nodes in one model update
    bool AddProperty2Node(QGraphicsItem* pItem_, const cat::Function& property_);
+
+   // Applies all edits in one model update: the set node is replaced once,
+   // each node's arrow to the set once, and the property panel, labels and
+   // filter are refreshed at the end. Each item is expected at most once.
+   bool SetProperties(const PropertyEdits& edits_);
    void RemovePropertyFromNode(QGraphicsItem* pItem_, const cat::FunctionName& name_);
 
+   // Removes the property from all items as one edit, the set node is
+   // replaced once and the property panel refreshed at the end
+   void RemoveProperty(const std::vector<QGraphicsItem*>& items_, const cat::FunctionName& name_);
+
    void OnContextMenu();
    QString Statistics();
+   int CountNodes() const;
+   int CountArrows() const;
    void New();
    void Filter(const QString& filter_);
    void ChangeLabel(const QString& name_);
    QList<QMap<QString, QString>> GetDescription() const;
 
+   // Ids of the nodes the filter shows, the values are read from Properties
+   QStringList VisibleNodes() const;
+   const PropertyStore& Properties() const;
+
    bool Build(const QString& path_);
    bool LoadBinary(const QString& path_);
    bool SaveBinary(const QString& path_) const;
 
+   // Saves a copy of the model on a worker thread, see saveFinished
+   void SaveAsync(const QString& path_);
+   bool IsSaving() const;
+
+   void LoadAsync(const QString& path_, Loader::EFormat format_);
+   void CancelLoad();
+   bool IsLoading() const;
+
+   void Layout();
+   void StopLayout();
+
+   // Draws all arrows through one edge layer instead of an item per arrow
+   void SetBatchedEdges(bool batched_);
+   bool BatchedEdges() const;
+
+   // Reverts the last edit, bulk edits such as a layout or a multi node
+   // drag are one step
+   void Undo();
+   void Redo();
+   bool CanUndo() const;
+   bool CanRedo() const;
+   QString UndoText() const;
+   QString RedoText() const;
+
+   // Bulk selection, the items change without notifying one by one and the
+   // scene publishes a single selectionChanged
+   void SelectAll();
+   void SelectNone();
+   void InvertSelection();
+   bool SelectMatching(const QString& filter_);
+   void SelectArea(const QRectF& rect_, Qt::ItemSelectionOperation operation_ = Qt::ReplaceSelection);
+
+   // Selected nodes, kept up to date as they change
+   const QSet<CNode*>& Selection() const;
+
 protected:
    void mousePressEvent(QGraphicsSceneMouseEvent* pEvent_) override;
    void mouseMoveEvent(QGraphicsSceneMouseEvent* pEvent_) override;
    void mouseReleaseEvent(QGraphicsSceneMouseEvent* pEvent_) override;
    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent* pEvent_) override;
    void dragMoveEvent(QGraphicsSceneDragDropEvent* pEvent_) override;
+   void helpEvent(QGraphicsSceneHelpEvent* pEvent_) override;
 
 signals:
    void updateStatistics(const QString&);
-   void updateNodeData(const std::list<cat::Function>&);
+   // Properties of the selected nodes, names they differ in are mixed
+   void updateNodeData(const std::list<cat::Function>& data_, const std::set<cat::FunctionName>& mixed_);
+
+   // Ids of edited nodes that are shown and of the ones hidden since
+   void updateRecords(const QStringList& shown_, const QStringList& hidden_);
+   void loadProgress(int done_, int total_);
+   void loadFinished(bool ok_);
+   void saveProgress(int done_, int total_);
+   void saveFinished(bool ok_, const QString& path_, const QString& error_);
+   void historyChanged();
+
+   // The model is about to be cleared or replaced, views reading it let go
+   void documentClosed();
 
 private slots:
    void selectionChanged();
    void slotActivated(QAction* pAction_);
    void positionChanged(const CNode* pNode_);
+   void nodesLoaded();
+   void modelLoaded(bool ok_);
+   void loadStep();
+   void modelSaved(bool ok_);
+   void applyLayout();
+   void nodeSelected(CNode* pNode_);
 
 private:
+   void createMenu();
    CNode* createNode(const QString& name_, const QPointF& pos_);
    CNode* createNode(const cat::Node& node_, const QPointF& pos_);
-   CArrow* createArrow(CNode* pSource_, CNode* pTarget_, const QString& name_, std::list<cat::Function> pFns_);
+   bool createArrow(CNode* pSource_, CNode* pTarget_, const QString& name_, std::list<cat::Function> pFns_);
+   CNode* addNodeItem(const QString& name_, const QPointF& pos_);
+   void addArrowItem(CNode* pSource_, CNode* pTarget_, const QString& name_);
+   bool load(const QString& path_, Loader::EFormat format_);
+   void finishLoad(bool ok_);
+   void startSave(const QString& path_, bool compact_);
+   void endSave(bool ok_);
+   void waitSave();
+   void detach();
+   void journal(const Journal::Record& record_);
+   void replay(const std::vector<Journal::Record>& records_);
+   void apply(const std::vector<Journal::Record>& records_);
+   void history(const QString& text_, std::vector<Journal::Record>&& inverse_);
+   void revert(const UndoHistory::Entry& entry_, UndoHistory::ETarget target_);
+   std::list<cat::Function> arrowValues(const cat::Arrow& arrow_);
+   // Replays the clone records of older journals, clones made now are
+   // journaled as the nodes and arrows cloneNodes creates
+   CNode* cloneNode(CNode* pNode_, const std::string& name_, const QPointF& pos_);
+   std::vector<CNode*> cloneNodes(const std::vector<CNode*>& nodes_, const QPointF& offset_, bool boundary_);
+   bool eraseNode(CNode* pNode_);
+   bool eraseArrow(const cat::Arrow& arrow_);
+   void startLayout(const QSet<CNode*>& pinned_, bool scatter_);
+   void finishLayout(bool commit_);
+   void commitMoved();
+   void commitPositions(const std::vector<CNode*>& nodes_);
    QGraphicsItem* getItem(const QString& name_) const;
+   void registerItem(QGraphicsItem* pItem_);
+   void unregisterItem(QGraphicsItem* pItem_);
+   void unregisterNode(CNode* pNode_);
    void changeLabel(QGraphicsItem* pItem_) const;
    QMap<QString, QString> getRecord(QGraphicsItem* pItem_) const;
+   bool isFiltered(const cat::FunctionName& name_) const;
+   bool matchesFilter(const CNode* pNode_) const;
+   void refilter(const std::vector<CNode*>& nodes_, bool reevaluate_);
+   void evaluate(const FilterProgram& program_, std::vector<CNode*>& nodes_, std::vector<int8_t>& matches_) const;
+   std::vector<CNode*> nodes() const;
+   std::vector<QGraphicsItem*> selection() const;
+   void publishSelection();
+   template <typename TFn>
+   void applySelection(const std::vector<CNode*>& nodes_, const TFn& selected_);
 
    std::shared_ptr<cat::Node>
                           m_pLCategory   {};
@@ -70,11 +194,66 @@ private:
    QPointF                m_LastMousePos;
    cat::FunctionName      m_ShownName;
 
+   // ID -> item index, kept in sync with the items added to the scene
+   QHash<QString, QGraphicsItem*>
+                          m_Items;
+
+   // Properties of the nodes, read paths are served from here
+   PropertyStore          m_Properties;
+
+   // Filter kept active so that edited nodes are re-evaluated
+   std::unique_ptr<FilterProgram>
+                          m_pFilter;
+
+   // Arrows of the scene when they are batched, owned by the scene
+   CEdgeLayer*            m_pEdgeLayer   {};
+   bool                   m_BatchedEdges {};
+
+   // Nodes moved since the last mouse release
+   QSet<CNode*>           m_Moved;
+
+   // Selected nodes, maintained from the nodes' selection changes
+   QSet<CNode*>           m_Selected;
+
    QMenu*                 m_pMnu         {};
    QAction*               m_pAddProp     {};
    QAction*               m_pClone       {};
+   QAction*               m_pCloneInternal {};
    QAction*               m_pCreateArrow {};
    QAction*               m_pDeleteArrow {};
+
+   // Progressive loading, items are added in time-sliced batches
+   Loader*                m_pLoader      {};
+   QTimer*                m_pLoadTimer   {};
+   std::vector<Loader::NodeRecord>
+                          m_LoadNodes;
+   std::vector<Loader::ArrowRecord>
+                          m_LoadArrows;
+   std::vector<CNode*>    m_LoadItems;
+   size_t                 m_LoadedArrows {};
+   bool                   m_ModelLoaded  {};
+
+   // Background save of a model copy, a save requested meanwhile waits
+   Saver*                 m_pSaver       {};
+   QString                m_SavePending;
+   bool                   m_Compacting   {};
+
+   // Edits since the .dat file was written, replayed on load
+   Journal                m_Journal;
+   bool                   m_Replaying    {};
+   QString                m_LoadPath;
+
+   // Undo and redo entries, stored as the edits reverting them
+   UndoHistory            m_History;
+
+   // Background layout, positions are applied in time-sliced batches
+   LayoutJob*             m_pLayout      {};
+   QTimer*                m_pLayoutTimer {};
+   std::vector<CNode*>    m_LayoutItems;
+   std::vector<ForceLayout::Point>
+                          m_LayoutPositions;
+   size_t                 m_LayoutApplied  {};
+   uint64_t               m_LayoutRevision {};
 };
 
 #endif
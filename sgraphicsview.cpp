@@ -2,10 +2,37 @@
 #include "ui_sgraphicsview.h"
 
 #include <QScrollBar>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QStyleOptionGraphicsItem>
+
+#include <cmath>
+
+#include "carrow.h"
+#include "cedgelayer.h"
+#include "cnode.h"
+#include "renderpass.h"
+#include "scene.h"
 
 static const qreal neg_scale = 0.9;
 static const qreal pos_scale = 1.1;
 
+// Delay after the last pan or zoom before full quality rendering is restored
+static const int   idle_ms   = 200;
+
+// Side of a cached tile in device independent pixels, and the cache budget
+static const int   tile_size = 256;
+static const int   max_tiles = 256;
+
+// Band drags shorter than this are clicks on the background
+static const int   band_min  = 4;
+
+//----------------------------------------------------------------------
+static quint64 tileKey(int x_, int y_)
+{
+   return (quint64(quint32(x_)) << 32) | quint32(y_);
+}
+
 //----------------------------------------------------------------------
 SGraphicsView::SGraphicsView(QWidget* pParent_) :
       QGraphicsView  (pParent_)
@@ -13,7 +40,19 @@ SGraphicsView::SGraphicsView(QWidget* pParent_) :
 {
    m_pUi->setupUi(this);
 
-   setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::HighQualityAntialiasing);
+   m_hints = QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::HighQualityAntialiasing;
+
+   setRenderHints(m_hints);
+
+   m_pIdle = new QTimer(this);
+   m_pIdle->setSingleShot(true);
+   m_pIdle->setInterval(idle_ms);
+
+   connect(m_pIdle, &QTimer::timeout, this, [this]()
+   {
+      setRenderHints(m_hints);
+      viewport()->update();
+   });
 
    setHorizontalScrollBarPolicy (Qt::ScrollBarPolicy::ScrollBarAlwaysOff);
    setVerticalScrollBarPolicy   (Qt::ScrollBarPolicy::ScrollBarAlwaysOff);
@@ -37,6 +76,8 @@ void SGraphicsView::wheelEvent(QWheelEvent* pEvent_)
 
       qreal factor = angle > 0 ? pos_scale : neg_scale;
 
+      interact();
+
       scale(factor, factor);
       setTransformationAnchor(anchor);
    }
@@ -55,6 +96,22 @@ void SGraphicsView::mousePressEvent(QMouseEvent* pEvent_)
       m_drag = true;
    }
 
+   // Pressed on the background, anything under the cursor handles it itself
+   if (pEvent_->button() == Qt::LeftButton && scene())
+   {
+      QGraphicsItem* pItem = itemAt(pEvent_->pos());
+
+      if (!pItem || !(pItem->flags() & QGraphicsItem::ItemIsSelectable))
+      {
+         if (!m_pBand)
+            m_pBand = new QRubberBand(QRubberBand::Rectangle, viewport());
+
+         m_bandOrigin = pEvent_->pos();
+         m_pBand->setGeometry(QRect(m_bandOrigin, QSize()));
+         m_pBand->show();
+      }
+   }
+
    QGraphicsView::mousePressEvent(pEvent_);
 }
 
@@ -69,14 +126,34 @@ void SGraphicsView::mouseReleaseEvent(QMouseEvent* pEvent_)
       m_drag = false;
    }
 
+   if (pEvent_->button() == Qt::LeftButton && m_pBand && m_pBand->isVisible())
+      selectBand(pEvent_->modifiers());
+
    QGraphicsView::mouseReleaseEvent(pEvent_);
+
+   if (m_liveActive && !(pEvent_->buttons() & Qt::LeftButton))
+      endLive();
 }
 
 //----------------------------------------------------------------------
 void SGraphicsView::mouseMoveEvent(QMouseEvent* pEvent_)
 {
+   // Taking the dragged items out of the tiles before they move
+   if ((pEvent_->buttons() & Qt::LeftButton) && !m_liveActive && scene())
+   {
+      QGraphicsItem* pGrabber = scene()->mouseGrabberItem();
+
+      if (pGrabber && (pGrabber->flags() & QGraphicsItem::ItemIsMovable))
+         beginLive();
+   }
+
+   if (m_pBand && m_pBand->isVisible())
+      m_pBand->setGeometry(QRect(m_bandOrigin, pEvent_->pos()).normalized());
+
    if (m_drag)
    {
+      interact();
+
       horizontalScrollBar  ()->setValue(horizontalScrollBar ()->value() - (pEvent_->x() - m_xpan));
       verticalScrollBar    ()->setValue(verticalScrollBar   ()->value() - (pEvent_->y() - m_ypan));
 
@@ -85,4 +162,329 @@ void SGraphicsView::mouseMoveEvent(QMouseEvent* pEvent_)
    }
 
    QGraphicsView::mouseMoveEvent(pEvent_);
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::selectBand(Qt::KeyboardModifiers modifiers_)
+{
+   m_pBand->hide();
+
+   QRect band = m_pBand->geometry();
+   if (band.width() < band_min && band.height() < band_min)
+      return;
+
+   // Done by the scene, the nodes do not publish their changes one by one
+   if (Scene* pScene = qobject_cast<Scene*>(scene()))
+   {
+      auto operation = modifiers_ & Qt::ControlModifier ? Qt::AddToSelection : Qt::ReplaceSelection;
+
+      pScene->SelectArea(mapToScene(band).boundingRect(), operation);
+   }
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::interact()
+{
+   if (!m_pIdle->isActive())
+      setRenderHints(QPainter::RenderHints());
+
+   m_pIdle->start();
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::paintEvent(QPaintEvent* pEvent_)
+{
+   if (!scene())
+   {
+      QGraphicsView::paintEvent(pEvent_);
+      return;
+   }
+
+   // Static content is all in the tiles, the scene's items are not visited.
+   // Only the dragged items and their arrows are painted on top.
+   QPainter painter(viewport());
+   painter.setRenderHints(renderHints());
+   painter.setWorldTransform(viewportTransform());
+
+   drawBackground(&painter, mapToScene(pEvent_->rect()).boundingRect());
+
+   if (!m_liveActive)
+      return;
+
+   for (QGraphicsItem* pItem : m_live)
+   {
+      if (dynamic_cast<CArrow*>(pItem))
+         paintItem(&painter, pItem);
+   }
+
+   if (!m_liveNodes.empty())
+   {
+      if (CEdgeLayer* pLayer = m_liveNodes.front()->EdgeLayer())
+      {
+         painter.save();
+         painter.setWorldTransform(pLayer->sceneTransform() * viewportTransform());
+
+         pLayer->PaintIncident(&painter, m_liveNodes);
+
+         painter.restore();
+      }
+   }
+
+   for (CNode* pNode : m_liveNodes)
+      paintItem(&painter, pNode);
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::paintItem(QPainter* pPainter_, QGraphicsItem* pItem_)
+{
+   if (!pItem_->isVisible())
+      return;
+
+   QStyleOptionGraphicsItem option;
+   option.exposedRect   = pItem_->boundingRect();
+   option.rect          = option.exposedRect.toAlignedRect();
+   option.palette       = palette();
+
+   if (pItem_->isEnabled())
+      option.state |= QStyle::State_Enabled;
+
+   if (pItem_->isSelected())
+      option.state |= QStyle::State_Selected;
+
+   pPainter_->save();
+   pPainter_->setWorldTransform(pItem_->sceneTransform() * viewportTransform());
+
+   pItem_->paint(pPainter_, &option, viewport());
+
+   pPainter_->restore();
+
+   // Labels follow their node
+   for (QGraphicsItem* pChild : pItem_->childItems())
+      paintItem(pPainter_, pChild);
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::drawBackground(QPainter* pPainter_, const QRectF& rect_)
+{
+   QGraphicsView::drawBackground(pPainter_, rect_);
+
+   if (!scene())
+      return;
+
+   if (m_pTiledScene != scene())
+   {
+      if (m_pTiledScene)
+         disconnect(m_pTiledScene, nullptr, this, nullptr);
+
+      m_pTiledScene = scene();
+      connect(m_pTiledScene, &QGraphicsScene::changed, this, &SGraphicsView::sceneChanged);
+
+      m_tiles.clear();
+   }
+
+   // Tiles are laid out in zoomed scene coordinates, a new zoom starts over
+   if (transform() != m_tileTransform)
+   {
+      m_tiles.clear();
+      m_tileTransform = transform();
+   }
+
+   QRectF zoomed = m_tileTransform.mapRect(rect_);
+
+   int x0 = (int)std::floor(zoomed.left  () / tile_size);
+   int y0 = (int)std::floor(zoomed.top   () / tile_size);
+   int x1 = (int)std::floor(zoomed.right () / tile_size);
+   int y1 = (int)std::floor(zoomed.bottom() / tile_size);
+
+   if (m_tiles.size() + (x1 - x0 + 1) * (y1 - y0 + 1) > max_tiles)
+      m_tiles.clear();
+
+   QPointF offset = viewportTransform().map(QPointF()) - m_tileTransform.map(QPointF());
+   offset = QPointF(qRound(offset.x()), qRound(offset.y()));
+
+   pPainter_->save();
+   pPainter_->resetTransform();
+
+   for (int y = y0; y <= y1; ++y)
+   {
+      for (int x = x0; x <= x1; ++x)
+      {
+         auto it = m_tiles.find(tileKey(x, y));
+         if (it == m_tiles.end())
+            it = m_tiles.insert(tileKey(x, y), renderTile(x, y));
+
+         pPainter_->drawPixmap(QPointF(x * tile_size, y * tile_size) + offset, it.value());
+      }
+   }
+
+   pPainter_->restore();
+}
+
+//----------------------------------------------------------------------
+QPixmap SGraphicsView::renderTile(int x_, int y_)
+{
+   qreal ratio = devicePixelRatioF();
+
+   QPixmap tile(QSize(tile_size, tile_size) * ratio);
+   tile.setDevicePixelRatio(ratio);
+   tile.fill(Qt::transparent);
+
+   QRectF source = m_tileTransform.inverted().mapRect(QRectF(x_ * tile_size, y_ * tile_size, tile_size, tile_size));
+
+   QPainter painter(&tile);
+
+   // Tiles are kept, they are rendered at full quality even while interacting
+   painter.setRenderHints(m_hints);
+
+   render::EPass pass = render::pass;
+   render::pass = render::EPass::eStatic;
+
+   scene()->render(&painter, QRectF(0, 0, tile_size, tile_size), source, Qt::IgnoreAspectRatio);
+
+   render::pass = pass;
+
+   return tile;
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::invalidateTiles(const QRectF& rect_)
+{
+   if (m_tiles.isEmpty())
+      return;
+
+   // A pixel of margin for antialiased edges
+   QRectF zoomed = m_tileTransform.mapRect(rect_).adjusted(-1, -1, 1, 1);
+
+   int x0 = (int)std::floor(zoomed.left  () / tile_size);
+   int y0 = (int)std::floor(zoomed.top   () / tile_size);
+   int x1 = (int)std::floor(zoomed.right () / tile_size);
+   int y1 = (int)std::floor(zoomed.bottom() / tile_size);
+
+   for (auto it = m_tiles.begin(); it != m_tiles.end(); )
+   {
+      int x = (int)quint32(it.key() >> 32);
+      int y = (int)quint32(it.key());
+
+      if (x >= x0 && x <= x1 && y >= y0 && y <= y1)
+         it = m_tiles.erase(it);
+      else
+         ++it;
+   }
+
+   viewport()->update(mapFromScene(rect_).boundingRect().adjusted(-2, -2, 2, 2));
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::sceneChanged(const QList<QRectF>& rects_)
+{
+   if (!m_liveActive)
+   {
+      for (const QRectF& rect : rects_)
+         invalidateTiles(rect);
+
+      return;
+   }
+
+   // Changes around the dragged items are theirs, the tiles there would be
+   // rendered again every frame. Anything else changing meanwhile, a layout
+   // step, loading or filtering, goes into the tiles right away.
+   QRectF live;
+   for (const QRectF& rect : liveRects())
+      live |= rect;
+
+   for (const QRectF& rect : rects_)
+   {
+      if (live.intersects(rect))
+         m_deferred |= rect;
+      else
+         invalidateTiles(rect);
+   }
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::beginLive()
+{
+   Scene* pScene = qobject_cast<Scene*>(scene());
+
+   // The scene keeps the selected nodes, no list of the items is built
+   QList<QGraphicsItem*> selected;
+
+   if (pScene)
+   {
+      for (CNode* pNode : pScene->Selection())
+         selected.push_back(pNode);
+   }
+   else
+   {
+      selected = scene()->selectedItems();
+   }
+
+   for (QGraphicsItem* pItem : selected)
+   {
+      if (!(pItem->flags() & QGraphicsItem::ItemIsMovable))
+         continue;
+
+      m_live.push_back(pItem);
+
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+      {
+         m_liveNodes.push_back(pNode);
+
+         for (CArrow* pArrow : pNode->Children())
+            m_live.push_back(pArrow);
+      }
+   }
+
+   for (QGraphicsItem* pItem : m_live)
+      pItem->setData(eLive, true);
+
+   for (const QRectF& rect : liveRects())
+      invalidateTiles(rect);
+
+   m_liveActive = true;
+}
+
+//----------------------------------------------------------------------
+void SGraphicsView::endLive()
+{
+   m_liveActive = false;
+
+   for (QGraphicsItem* pItem : m_live)
+      pItem->setData(eLive, QVariant());
+
+   // Back into the tiles at their final place, with what changed around
+   // them during the drag
+   for (const QRectF& rect : liveRects())
+      invalidateTiles(rect);
+
+   if (!m_deferred.isNull())
+      invalidateTiles(m_deferred);
+
+   m_deferred = QRectF();
+
+   m_live     .clear();
+   m_liveNodes.clear();
+}
+
+//----------------------------------------------------------------------
+std::vector<QRectF> SGraphicsView::liveRects() const
+{
+   std::vector<QRectF> rects;
+
+   for (QGraphicsItem* pItem : m_live)
+   {
+      rects.push_back(pItem->mapToScene(pItem->boundingRect() | pItem->childrenBoundingRect()).boundingRect());
+
+      // Batched arrows of the node are drawn by the layer
+      if (CNode* pNode = dynamic_cast<CNode*>(pItem))
+      {
+         if (CEdgeLayer* pLayer = pNode->EdgeLayer())
+         {
+            for (int edge : pLayer->Incident(pNode))
+               rects.push_back(pLayer->Bounds(edge));
+         }
+      }
+   }
+
+   return rects;
+}
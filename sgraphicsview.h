@@ -6,11 +6,19 @@
 #include <QTimer>
 #include <QWheelEvent>
 #include <QMouseEvent>
+#include <QHash>
+#include <QPixmap>
+#include <QPointer>
+#include <QRubberBand>
+
+#include <vector>
 
 namespace Ui {
 class SGraphicsView;
 }
 
+class CNode;
+
 class SGraphicsView : public QGraphicsView
 {
     Q_OBJECT
@@ -24,11 +32,52 @@ protected:
    void mousePressEvent(QMouseEvent* pEvent_) override;
    void mouseReleaseEvent(QMouseEvent* pEvent_) override;
    void mouseMoveEvent(QMouseEvent* pEvent_) override;
+   void paintEvent(QPaintEvent* pEvent_) override;
+   void drawBackground(QPainter* pPainter_, const QRectF& rect_) override;
+
+   // Drops antialiasing until the view has been idle for a while
+   void interact();
+
+   // Static content is served from tiles rendered at the current zoom, the
+   // items being dragged are painted over them every frame
+   QPixmap renderTile(int x_, int y_);
+   void invalidateTiles(const QRectF& rect_);
+   void sceneChanged(const QList<QRectF>& rects_);
+   void beginLive();
+   void endLive();
+   std::vector<QRectF> liveRects() const;
+
+   // Paints the item and its children the way the view would
+   void paintItem(QPainter* pPainter_, QGraphicsItem* pItem_);
+
+   // Selection of the nodes under the band, as one change of the scene
+   void selectBand(Qt::KeyboardModifiers modifiers_);
 
    Ui::SGraphicsView*   m_pUi    {};
    int                  m_xpan   {};
    int                  m_ypan   {};
    bool                 m_drag   {};
+
+   QTimer*              m_pIdle  {};
+   QPainter::RenderHints
+                        m_hints;
+
+   QHash<quint64, QPixmap>
+                        m_tiles;
+   QTransform           m_tileTransform;
+   QPointer<QGraphicsScene>
+                        m_pTiledScene;
+
+   std::vector<QGraphicsItem*>
+                        m_live;
+   std::vector<CNode*>  m_liveNodes;
+   bool                 m_liveActive {};
+
+   // Changes next to the dragged items, refreshed once the drag ends
+   QRectF               m_deferred;
+
+   QRubberBand*         m_pBand     {};
+   QPoint               m_bandOrigin;
 };
 
 #endif
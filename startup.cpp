@@ -0,0 +1,26 @@
+#include "startup.h"
+
+#include <QElapsedTimer>
+
+Q_LOGGING_CATEGORY(lcStartup, "cateditor.startup")
+
+//----------------------------------------------------------------------
+// Not a global named clock, that would clash with ::clock from <time.h>
+static QElapsedTimer& timer()
+{
+   static QElapsedTimer elapsed;
+   return elapsed;
+}
+
+//----------------------------------------------------------------------
+void startup::Start()
+{
+   timer().start();
+}
+
+//----------------------------------------------------------------------
+void startup::Mark(const char* stage_)
+{
+   if (timer().isValid())
+      qCInfo(lcStartup) << stage_ << timer().elapsed() << "ms";
+}
@@ -0,0 +1,16 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(lcStartup)
+
+// Startup timings, logged relative to Start() at the top of main. Silence
+// with QT_LOGGING_RULES="cateditor.startup=false"
+namespace startup
+{
+   void Start();
+   void Mark(const char* stage_);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+// Assertions of the test executables, a failed check is printed and
+// counted. main returns non-zero when failures is set once all checks ran.
+namespace test
+{
+   inline int failures {};
+
+   inline void check(bool condition_, const char* what_)
+   {
+      if (condition_)
+         return;
+
+      std::printf("FAILED: %s\n", what_);
+      ++failures;
+   }
+}
+
+#endif
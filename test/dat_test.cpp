@@ -0,0 +1,202 @@
+#include "check.h"
+#include "datfile.h"
+
+using namespace cat;
+using test::check;
+
+//----------------------------------------------------------------------
+static bool same(const dat::Property& left_, const dat::Property& right_)
+{
+   return   left_.name     == right_.name
+      &&    left_.type     == right_.type
+      &&    left_.number   == right_.number
+      &&    left_.text     == right_.text;
+}
+
+//----------------------------------------------------------------------
+static bool same(const dat::Document& left_, const dat::Document& right_)
+{
+   if (left_.nodes != right_.nodes || left_.arrows.size() != right_.arrows.size() || left_.properties.size() != right_.properties.size())
+      return false;
+
+   for (size_t i = 0; i < left_.arrows.size(); ++i)
+   {
+      const dat::Arrow& left  = left_.arrows[i];
+      const dat::Arrow& right = right_.arrows[i];
+
+      if (  left.name            != right.name
+         || left.source          != right.source
+         || left.target          != right.target
+         || left.first_property  != right.first_property
+         || left.property_count  != right.property_count)
+         return false;
+   }
+
+   for (size_t i = 0; i < left_.properties.size(); ++i)
+   {
+      if (!same(left_.properties[i], right_.properties[i]))
+         return false;
+   }
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+// Two nodes, an arrow with one property of each type and one without
+static void fill(dat::Document& doc_)
+{
+   doc_.nodes = { doc_.Own("a"), doc_.Own("b"), doc_.Own("") };
+
+   dat::Arrow arrow { doc_.Own("f"), doc_.nodes[0], doc_.nodes[1] };
+
+   arrow.first_property = (uint32_t)doc_.properties.size();
+
+   doc_.properties.push_back(dat::FromValue(Function("weight", 2.5),                  doc_));
+   doc_.properties.push_back(dat::FromValue(Function("ratio",  0.5f),                 doc_));
+   doc_.properties.push_back(dat::FromValue(Function("x_",     -10),                  doc_));
+   doc_.properties.push_back(dat::FromValue(Function("label",  std::string("a to b")), doc_));
+
+   // Shares its string with a node name
+   doc_.properties.push_back(dat::FromValue(Function("other",  std::string("b")),     doc_));
+
+   arrow.property_count = (uint32_t)doc_.properties.size() - arrow.first_property;
+
+   doc_.arrows.push_back(arrow);
+   doc_.arrows.push_back({ doc_.Own("g"), doc_.nodes[1], doc_.nodes[1], (uint32_t)doc_.properties.size(), 0 });
+}
+
+//----------------------------------------------------------------------
+template <typename T>
+static void put(std::string& out_, const T& value_)
+{
+   out_.append((const char*)&value_, sizeof(value_));
+}
+
+//----------------------------------------------------------------------
+static void put(std::string& out_, std::string_view str_)
+{
+   put(out_, str_.size());
+   out_.append(str_.data(), str_.size());
+}
+
+//----------------------------------------------------------------------
+// The legacy layout as the editor wrote it before v2
+static std::string writeV1(const dat::Document& doc_)
+{
+   std::string out;
+
+   put(out, doc_.nodes.size());
+
+   for (std::string_view name : doc_.nodes)
+      put(out, name);
+
+   put(out, doc_.arrows.size());
+
+   for (const dat::Arrow& arrow : doc_.arrows)
+   {
+      put(out, arrow.name);
+      put(out, arrow.source);
+      put(out, arrow.target);
+      put(out, (size_t)arrow.property_count);
+
+      for (uint32_t i = 0; i < arrow.property_count; ++i)
+      {
+         const dat::Property& prop = doc_.properties[arrow.first_property + i];
+
+         put(out, prop.name);
+         put(out, (size_t)prop.type);
+
+         switch (prop.type)
+         {
+         case ESetTypes::eDouble:   put(out, prop.number);             break;
+         case ESetTypes::eFloat:    put(out, float(prop.number));      break;
+         case ESetTypes::eInt:      put(out, int(prop.number));        break;
+         case ESetTypes::eString:   put(out, prop.text);               break;
+         }
+      }
+   }
+
+   return out;
+}
+
+//----------------------------------------------------------------------
+static void testV2()
+{
+   dat::Document doc;
+   fill(doc);
+
+   std::string data;
+   check(dat::Write(doc, data), "v2 written");
+
+   dat::Document read;
+   check(dat::Read(data.data(), data.size(), read), "v2 read");
+   check(same(doc, read), "v2 round trip");
+
+   // Values survive the trip through the document as well
+   check(dat::ToValue(read.properties[0]) == TSetValue(2.5),                  "double value");
+   check(dat::ToValue(read.properties[1]) == TSetValue(0.5f),                 "float value");
+   check(dat::ToValue(read.properties[2]) == TSetValue(-10),                  "int value");
+   check(dat::ToValue(read.properties[3]) == TSetValue(std::string("a to b")), "string value");
+
+   std::string written;
+   check(dat::Write(read, written) && written == data, "v2 rewritten unchanged");
+
+   // Every cut of the file is refused, the document is left empty
+   for (size_t size = 0; size < data.size(); ++size)
+   {
+      if (dat::Read(data.data(), size, read) || !read.nodes.empty() || !read.arrows.empty() || !read.properties.empty())
+      {
+         check(false, "truncated v2 refused");
+         break;
+      }
+   }
+
+   std::string corrupt = data;
+   corrupt[4] = char(dat::version + 1);
+
+   check(!dat::Read(corrupt.data(), corrupt.size(), read), "unknown version refused");
+}
+
+//----------------------------------------------------------------------
+static void testV1()
+{
+   dat::Document doc;
+   fill(doc);
+
+   std::string data = writeV1(doc);
+
+   dat::Document read;
+   check(dat::Read(data.data(), data.size(), read), "v1 read");
+   check(same(doc, read), "v1 round trip");
+
+   // A v1 file is saved again as v2
+   std::string converted;
+   check(dat::Write(read, converted), "v1 written as v2");
+
+   dat::Document reread;
+   check(dat::Read(converted.data(), converted.size(), reread) && same(doc, reread), "v1 converted to v2");
+
+   check(!dat::Read(data.data(), data.size() - 1, read), "truncated v1 refused");
+}
+
+//----------------------------------------------------------------------
+static void testEmpty()
+{
+   dat::Document doc;
+
+   std::string data;
+   check(dat::Write(doc, data), "empty document written");
+
+   dat::Document read;
+   check(dat::Read(data.data(), data.size(), read) && same(doc, read), "empty document read");
+}
+
+//----------------------------------------------------------------------
+int main()
+{
+   testV2();
+   testV1();
+   testEmpty();
+
+   return test::failures ? 1 : 0;
+}
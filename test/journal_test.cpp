@@ -0,0 +1,199 @@
+#include <cstdio>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "check.h"
+#include "journal.h"
+
+using namespace cat;
+using test::check;
+
+//----------------------------------------------------------------------
+static bool same(const Journal::Record& left_, const Journal::Record& right_)
+{
+   return   left_.type        == right_.type
+      &&    left_.names       == right_.names
+      &&    left_.pos         == right_.pos
+      &&    left_.properties  == right_.properties;
+}
+
+//----------------------------------------------------------------------
+static bool same(const std::vector<Journal::Record>& left_, const std::vector<Journal::Record>& right_)
+{
+   if (left_.size() != right_.size())
+      return false;
+
+   for (size_t i = 0; i < left_.size(); ++i)
+   {
+      if (!same(left_[i], right_[i]))
+         return false;
+   }
+
+   return true;
+}
+
+//----------------------------------------------------------------------
+static void writeBase(const QString& path_, const QByteArray& data_)
+{
+   QFile file(path_);
+   file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+   file.write(data_);
+}
+
+//----------------------------------------------------------------------
+static std::vector<Journal::Record> records()
+{
+   return
+   {
+      { Journal::ERecord::eAddNode,       { "a" },             QPointF(10, 20) },
+      { Journal::ERecord::eAddArrow,      { "f", "a", "b" },   QPointF(),        { { "weight", 2.5 } } },
+      { Journal::ERecord::eSetProperties, { "a" },             QPointF(),        { { "x_", 10 }, { "name", std::string("node a") }, { "ratio", 0.5f } } },
+      { Journal::ERecord::eRemoveProperty,{ "a", "name" } },
+      { Journal::ERecord::eEraseNode,     { "b" } },
+   };
+}
+
+//----------------------------------------------------------------------
+// Records read back as appended
+static void testRoundTrip(const QString& base_)
+{
+   writeBase(base_, "base");
+
+   Journal journal;
+   journal.Open(base_);
+
+   check(!QFile::exists(Journal::PathFor(base_)), "journal created before the first record");
+
+   for (const auto& record : records())
+      journal.Append(record);
+
+   check(journal.Size() > 0, "journal size after appending");
+   check(same(Journal::Read(base_), records()), "records read back");
+
+   journal.Close();
+}
+
+//----------------------------------------------------------------------
+// A record cut short by a crash ends the replay, the next edit replaces it
+static void testTornTail(const QString& base_)
+{
+   writeBase(base_, "base");
+
+   {
+      Journal journal;
+      journal.Open(base_);
+
+      for (const auto& record : records())
+         journal.Append(record);
+   }
+
+   QFile file(Journal::PathFor(base_));
+   file.open(QIODevice::ReadWrite);
+   file.resize(file.size() - 3);
+   file.close();
+
+   std::vector<Journal::Record> expected = records();
+   expected.pop_back();
+
+   check(same(Journal::Read(base_), expected), "torn record dropped");
+
+   Journal::Record added { Journal::ERecord::eCloneNode, { "a", "c" }, QPointF(1, 2) };
+
+   {
+      Journal journal;
+      journal.Open(base_);
+      journal.Append(added);
+   }
+
+   expected.push_back(added);
+
+   check(same(Journal::Read(base_), expected), "append after a torn record");
+
+   // A corrupted payload fails its checksum
+   file.open(QIODevice::ReadWrite);
+   file.seek(file.size() - 1);
+   file.write("\xff");
+   file.close();
+
+   expected.pop_back();
+
+   check(same(Journal::Read(base_), expected), "corrupted record dropped");
+}
+
+//----------------------------------------------------------------------
+// The journal of an older version of the base is ignored
+static void testStaleBase(const QString& base_)
+{
+   writeBase(base_, "base");
+
+   {
+      Journal journal;
+      journal.Open(base_);
+      journal.Append(records().front());
+   }
+
+   check(Journal::Read(base_).size() == 1, "journal of the current base");
+
+   writeBase(base_, "rewritten base");
+
+   check(Journal::Read(base_).empty(), "journal of a rewritten base ignored");
+}
+
+//----------------------------------------------------------------------
+// After a save only the records appended since the snapshot remain
+static void testRebase(const QString& base_, const QString& other_)
+{
+   writeBase(base_, "base");
+
+   std::vector<Journal::Record> all = records();
+
+   Journal journal;
+   journal.Open(base_);
+
+   journal.Append(all[0]);
+   journal.Append(all[1]);
+
+   journal.Mark();
+
+   journal.Append(all[2]);
+   journal.Append(all[3]);
+
+   writeBase(other_, "saved snapshot");
+
+   check(journal.Rebase(other_), "rebase");
+   check(journal.Base() == other_, "base after rebase");
+   check(same(Journal::Read(other_), { all[2], all[3] }), "records since the mark");
+
+   journal.Append(all[4]);
+
+   check(same(Journal::Read(other_), { all[2], all[3], all[4] }), "append after rebase");
+
+   // Nothing since the mark, the journal goes until the next edit
+   journal.Mark();
+
+   writeBase(other_, "saved again");
+
+   check(journal.Rebase(other_), "rebase without records");
+   check(!QFile::exists(Journal::PathFor(other_)), "empty journal removed");
+
+   journal.Close();
+}
+
+//----------------------------------------------------------------------
+int main()
+{
+   QTemporaryDir dir;
+   if (!dir.isValid())
+   {
+      std::printf("FAILED: temporary directory\n");
+      return 1;
+   }
+
+   testRoundTrip  (dir.filePath("roundtrip.dat"));
+   testTornTail   (dir.filePath("torn.dat"));
+   testStaleBase  (dir.filePath("stale.dat"));
+   testRebase     (dir.filePath("rebase.dat"), dir.filePath("saved.dat"));
+
+   return test::failures ? 1 : 0;
+}
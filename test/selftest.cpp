@@ -0,0 +1,8 @@
+#include "../Cat/test/test.h"
+
+int main()
+{
+   test();
+
+   return 0;
+}
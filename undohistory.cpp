@@ -0,0 +1,207 @@
+#include "undohistory.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace cat;
+
+// Entries kept at most, whatever their size
+static const size_t  max_entries    = 1000;
+
+//----------------------------------------------------------------------
+UndoHistory::UndoHistory(size_t budget_) :
+   m_budget(budget_)
+{
+}
+
+//----------------------------------------------------------------------
+void UndoHistory::Clear()
+{
+   m_undo.clear();
+   m_redo.clear();
+   m_bytes = 0;
+
+   m_chunks.clear();
+   m_openBytes = 0;
+   m_overflow  = false;
+}
+
+//----------------------------------------------------------------------
+void UndoHistory::Begin(const QString& text_, ETarget target_)
+{
+   if (m_depth++ > 0)
+      return;
+
+   m_text      = text_;
+   m_target    = target_;
+   m_openBytes = 0;
+   m_overflow  = false;
+
+   m_chunks.clear();
+}
+
+//----------------------------------------------------------------------
+void UndoHistory::End()
+{
+   if (m_depth == 0 || --m_depth > 0)
+      return;
+
+   commit();
+}
+
+//----------------------------------------------------------------------
+void UndoHistory::Add(const QString& text_, std::vector<Journal::Record>&& inverse_)
+{
+   if (inverse_.empty())
+      return;
+
+   bool single = m_depth == 0;
+
+   if (single)
+      Begin(text_);
+
+   // Nothing is kept of a group past the budget, it is dropped on commit
+   if (!m_overflow)
+   {
+      for (const Journal::Record& record : inverse_)
+         m_openBytes += bytes(record);
+
+      m_overflow = m_openBytes > m_budget;
+
+      if (m_overflow)
+         m_chunks.clear();
+      else
+         m_chunks.push_back(std::move(inverse_));
+   }
+
+   if (single)
+      End();
+}
+
+//----------------------------------------------------------------------
+bool UndoHistory::CanUndo() const
+{
+   return !m_undo.empty();
+}
+
+//----------------------------------------------------------------------
+bool UndoHistory::CanRedo() const
+{
+   return !m_redo.empty();
+}
+
+//----------------------------------------------------------------------
+QString UndoHistory::UndoText() const
+{
+   return m_undo.empty() ? QString() : m_undo.back().text;
+}
+
+//----------------------------------------------------------------------
+QString UndoHistory::RedoText() const
+{
+   return m_redo.empty() ? QString() : m_redo.back().text;
+}
+
+//----------------------------------------------------------------------
+UndoHistory::Entry UndoHistory::TakeUndo()
+{
+   Entry entry = std::move(m_undo.back());
+   m_undo.pop_back();
+
+   m_bytes -= entry.bytes;
+
+   return entry;
+}
+
+//----------------------------------------------------------------------
+UndoHistory::Entry UndoHistory::TakeRedo()
+{
+   Entry entry = std::move(m_redo.back());
+   m_redo.pop_back();
+
+   m_bytes -= entry.bytes;
+
+   return entry;
+}
+
+//----------------------------------------------------------------------
+size_t UndoHistory::Bytes() const
+{
+   return m_bytes;
+}
+
+//----------------------------------------------------------------------
+size_t UndoHistory::bytes(const Journal::Record& record_)
+{
+   size_t ret = sizeof(Journal::Record);
+
+   for (const std::string& name : record_.names)
+      ret += name.capacity();
+
+   for (const auto& [name, value] : record_.properties)
+   {
+      // List node, name and value
+      ret += sizeof(Function) + 2 * sizeof(void*) + name.capacity();
+
+      if (const std::string* pVal = std::get_if<std::string>(&value))
+         ret += pVal->capacity();
+   }
+
+   return ret;
+}
+
+//----------------------------------------------------------------------
+void UndoHistory::commit()
+{
+   if (m_overflow)
+   {
+      // Older entries cannot be applied on top of an edit that was not kept
+      Clear();
+      return;
+   }
+
+   if (m_chunks.empty())
+      return;
+
+   if (m_target == ETarget::eEdit)
+   {
+      for (const Entry& entry : m_redo)
+         m_bytes -= entry.bytes;
+
+      m_redo.clear();
+   }
+
+   Entry entry;
+   entry.text  = m_text;
+   entry.bytes = m_openBytes;
+
+   // An edit is reverted after the ones made later in the group
+   for (auto it = m_chunks.rbegin(); it != m_chunks.rend(); ++it)
+      std::move(it->begin(), it->end(), std::back_inserter(entry.records));
+
+   m_chunks.clear();
+   m_openBytes = 0;
+
+   m_bytes += entry.bytes;
+
+   (m_target == ETarget::eRedo ? m_redo : m_undo).push_back(std::move(entry));
+
+   trim();
+}
+
+//----------------------------------------------------------------------
+void UndoHistory::trim()
+{
+   // Oldest first: the bottom of the undo stack, then the deepest redo
+   while (!m_undo.empty() && (m_bytes > m_budget || m_undo.size() + m_redo.size() > max_entries))
+   {
+      m_bytes -= m_undo.front().bytes;
+      m_undo.pop_front();
+   }
+
+   while (!m_redo.empty() && (m_bytes > m_budget || m_redo.size() > max_entries))
+   {
+      m_bytes -= m_redo.front().bytes;
+      m_redo.pop_front();
+   }
+}
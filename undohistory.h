@@ -0,0 +1,83 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <deque>
+#include <vector>
+
+#include <QString>
+
+#include "journal.h"
+
+// Undo and redo entries of the scene. An entry holds the edits that revert
+// it, in the journal's record format, never a copy of the model. Applying
+// an entry records the edits reverting that in turn, which become the
+// entry of the opposite stack, so each edit is stored in one direction only.
+//
+// Memory is bounded by an estimate of the bytes held: the oldest entries
+// are dropped first, an edit too large for the budget on its own clears the
+// history and cannot be undone.
+class UndoHistory
+{
+public:
+   // Stack the entry of an open group goes to
+   enum class ETarget
+   {
+         eEdit       // undo stack, redo is cleared
+      ,  eUndo       // undo stack, while applying a redo entry
+      ,  eRedo       // redo stack, while applying an undo entry
+   };
+
+   struct Entry
+   {
+      QString                    text;
+      std::vector<Journal::Record>
+                                 records;
+      size_t                     bytes    {};
+   };
+
+   explicit UndoHistory(size_t budget_);
+
+   void Clear();
+
+   // Edits made until the matching End form one entry, groups nest and the
+   // outermost one decides the text and target
+   void Begin(const QString& text_, ETarget target_ = ETarget::eEdit);
+   void End();
+
+   // Edits reverting the one just made, outside of a group they form an
+   // entry of their own named text_
+   void Add(const QString& text_, std::vector<Journal::Record>&& inverse_);
+
+   bool CanUndo() const;
+   bool CanRedo() const;
+   QString UndoText() const;
+   QString RedoText() const;
+
+   // Removes the entry, its records are in the order to apply them
+   Entry TakeUndo();
+   Entry TakeRedo();
+
+   size_t Bytes() const;
+
+private:
+   static size_t bytes(const Journal::Record& record_);
+
+   void commit();
+   void trim();
+
+   std::deque<Entry>          m_undo;
+   std::deque<Entry>          m_redo;
+   size_t                     m_bytes     {};
+   size_t                     m_budget    {};
+
+   // Inverses of the open group, one chunk per edit
+   std::vector<std::vector<Journal::Record>>
+                              m_chunks;
+   QString                    m_text;
+   ETarget                    m_target    {};
+   size_t                     m_openBytes {};
+   int                        m_depth     {};
+   bool                       m_overflow  {};
+};
+
+#endif